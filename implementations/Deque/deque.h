@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Deque - двусторонняя очередь из блоков фиксированного размера. Элементы
+// лежат в блоках по kBlockSize штук (около 4 КБ), а указатели на блоки - в
+// каталоге. Добавление и удаление с обоих концов за O(1) амортизированно:
+// при росте переезжают только указатели в каталоге, а сами элементы никогда
+// не перемещаются, поэтому ссылки и указатели на них остаются
+// действительными, пока элемент не удален. Внутри блока элементы лежат
+// подряд, так что проход по деку почти такой же быстрый, как по массиву.
+//
+// Элемент с номером i лежит в позиции start_ + i: блок (start_ + i) /
+// kBlockSize, место (start_ + i) % kBlockSize. Выделены только блоки, в
+// которых есть элементы, плюс один запасной, чтобы очередь, переходящая
+// границу блока туда и обратно, не выделяла память каждый раз.
+template <class T> class Deque {
+  // Степень двойки, чтобы номер блока и место считались сдвигом и маской
+  static constexpr std::size_t block_size() {
+    std::size_t n = 16;
+    while (n * 2 * sizeof(T) <= 4096) {
+      n *= 2;
+    }
+    return n;
+  }
+
+public:
+  static constexpr std::size_t kBlockSize = block_size();
+
+private:
+  // Каталог блоков; последний слот всегда nullptr, чтобы итератор конца
+  // всегда указывал внутрь каталога
+  std::vector<T *> map;
+  std::size_t start_ = 0;
+  std::size_t size_ = 0;
+  T *spare = nullptr;
+
+  std::size_t map_capacity() const { return map.empty() ? 0 : map.size() - 1; }
+
+  T *take_block() {
+    if (spare) {
+      return std::exchange(spare, nullptr);
+    }
+    return std::allocator<T>().allocate(kBlockSize);
+  }
+
+  void give_block(T *block) {
+    if (spare) {
+      std::allocator<T>().deallocate(block, kBlockSize);
+    } else {
+      spare = block;
+    }
+  }
+
+  T &at_position(std::size_t position) const {
+    return map[position / kBlockSize][position % kBlockSize];
+  }
+
+  // Переносит указатели на занятые блоки в середину каталога, если нужно -
+  // в новый каталог вдвое больше. Элементы не двигаются [O(число блоков)]
+  void make_room() {
+    std::size_t first = start_ / kBlockSize;
+    std::size_t used = size_ ? (start_ + size_ - 1) / kBlockSize - first + 1 : 0;
+    std::size_t capacity = map_capacity();
+    if ((used + 1) * 2 > capacity) {
+      capacity = std::max<std::size_t>(8, capacity * 2);
+    }
+    std::vector<T *> directory(capacity + 1, nullptr);
+    std::size_t new_first = (capacity - used) / 2;
+    std::copy(map.begin() + first, map.begin() + first + used,
+              directory.begin() + new_first);
+    map.swap(directory);
+    start_ = new_first * kBlockSize + start_ % kBlockSize;
+  }
+
+  // Пустой дек начинает с середины каталога, чтобы было куда расти в обе
+  // стороны
+  void center() {
+    if (map_capacity() == 0) {
+      make_room();
+    }
+    start_ = map_capacity() / 2 * kBlockSize;
+  }
+
+  template <bool Const> class Iter {
+    friend class Deque;
+    template <bool> friend class Iter;
+    using Block = std::conditional_t<Const, T *const *, T **>;
+
+    Block node = nullptr; // слот каталога с текущим блоком
+    T *cur = nullptr;     // у конца на границе блока - nullptr
+
+    Iter(Block node_, T *cur_) : node(node_), cur(cur_) {}
+
+    // Место в текущем блоке; у итераторов пустого дека каталога нет
+    std::ptrdiff_t offset() const { return node ? cur - *node : 0; }
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const T *, T *>;
+    using reference = std::conditional_t<Const, const T &, T &>;
+
+    Iter() = default;
+
+    // Из изменяемого итератора получается константный
+    template <bool OtherConst, class = std::enable_if_t<Const && !OtherConst>>
+    Iter(const Iter<OtherConst> &other) : node(other.node), cur(other.cur) {}
+
+    reference operator*() const { return *cur; }
+    pointer operator->() const { return cur; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    Iter &operator++() {
+      if (++cur == *node + kBlockSize) {
+        cur = *++node;
+      }
+      return *this;
+    }
+
+    Iter &operator--() {
+      if (cur == *node) {
+        cur = *--node + kBlockSize;
+      }
+      --cur;
+      return *this;
+    }
+
+    Iter operator++(int) {
+      Iter tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    Iter operator--(int) {
+      Iter tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+    Iter &operator+=(difference_type n) {
+      if (n == 0) {
+        return *this;
+      }
+      difference_type position = offset() + n;
+      difference_type block = position >= 0
+                                  ? position / difference_type(kBlockSize)
+                                  : -((-position - 1) / difference_type(kBlockSize)) - 1;
+      node += block;
+      position -= block * difference_type(kBlockSize);
+      cur = *node ? *node + position : nullptr;
+      return *this;
+    }
+
+    Iter &operator-=(difference_type n) { return *this += -n; }
+
+    friend Iter operator+(Iter it, difference_type n) { return it += n; }
+    friend Iter operator+(difference_type n, Iter it) { return it += n; }
+    friend Iter operator-(Iter it, difference_type n) { return it -= n; }
+
+    friend difference_type operator-(const Iter &a, const Iter &b) {
+      return (a.node - b.node) * difference_type(kBlockSize) + a.offset() - b.offset();
+    }
+
+    friend bool operator==(const Iter &a, const Iter &b) { return a.cur == b.cur; }
+    friend bool operator!=(const Iter &a, const Iter &b) { return a.cur != b.cur; }
+    friend bool operator<(const Iter &a, const Iter &b) { return a - b < 0; }
+    friend bool operator>(const Iter &a, const Iter &b) { return b < a; }
+    friend bool operator<=(const Iter &a, const Iter &b) { return !(b < a); }
+    friend bool operator>=(const Iter &a, const Iter &b) { return !(a < b); }
+  };
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using iterator = Iter<false>;
+  using const_iterator = Iter<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // Создает пустой дек, память не выделяется
+  Deque() = default;
+
+  // Конструкторы делегируют пустому, чтобы при исключении из копирования
+  // элемента деструктор убрал уже созданные
+  Deque(std::initializer_list<T> items) : Deque() {
+    for (const T &item : items) {
+      emplace_back(item);
+    }
+  }
+
+  // Создает новый дек, являющийся глубокой копией дека other [O(n)]
+  Deque(const Deque &other) : Deque() {
+    for (const T &item : other) {
+      emplace_back(item);
+    }
+  }
+
+  Deque(Deque &&other) noexcept { swap(other); }
+
+  Deque &operator=(const Deque &other) {
+    if (this != &other) {
+      Deque tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  Deque &operator=(Deque &&other) noexcept {
+    Deque tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  ~Deque() {
+    clear();
+    if (spare) {
+      std::allocator<T>().deallocate(spare, kBlockSize);
+    }
+  }
+
+  void swap(Deque &other) noexcept {
+    map.swap(other.map);
+    std::swap(start_, other.start_);
+    std::swap(size_, other.size_);
+    std::swap(spare, other.spare);
+  }
+
+  std::size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  T &operator[](std::size_t index) { return at_position(start_ + index); }
+  const T &operator[](std::size_t index) const { return at_position(start_ + index); }
+
+  T &front() { return at_position(start_); }
+  const T &front() const { return at_position(start_); }
+  T &back() { return at_position(start_ + size_ - 1); }
+  const T &back() const { return at_position(start_ + size_ - 1); }
+
+  // Создает элемент из args в конце дека и возвращает ссылку на него
+  template <class... Args> T &emplace_back(Args &&...args) {
+    if (size_ == 0) {
+      center();
+    }
+    if ((start_ + size_) / kBlockSize >= map_capacity()) {
+      make_room();
+    }
+    std::size_t position = start_ + size_;
+    T *&block = map[position / kBlockSize];
+    bool new_block = position % kBlockSize == 0;
+    if (new_block) {
+      block = take_block();
+    }
+    try {
+      ::new (static_cast<void *>(block + position % kBlockSize)) T(std::forward<Args>(args)...);
+    } catch (...) {
+      if (new_block) {
+        give_block(std::exchange(block, nullptr));
+      }
+      throw;
+    }
+    ++size_;
+    return block[position % kBlockSize];
+  }
+
+  // Создает элемент из args в начале дека и возвращает ссылку на него
+  template <class... Args> T &emplace_front(Args &&...args) {
+    if (size_ == 0) {
+      center();
+    }
+    if (start_ == 0) {
+      make_room();
+    }
+    std::size_t position = start_ - 1;
+    T *&block = map[position / kBlockSize];
+    bool new_block = start_ % kBlockSize == 0;
+    if (new_block) {
+      block = take_block();
+    }
+    try {
+      ::new (static_cast<void *>(block + position % kBlockSize)) T(std::forward<Args>(args)...);
+    } catch (...) {
+      if (new_block) {
+        give_block(std::exchange(block, nullptr));
+      }
+      throw;
+    }
+    start_ = position;
+    ++size_;
+    return block[position % kBlockSize];
+  }
+
+  void push_back(const T &x) { emplace_back(x); }
+  void push_back(T &&x) { emplace_back(std::move(x)); }
+  void push_front(const T &x) { emplace_front(x); }
+  void push_front(T &&x) { emplace_front(std::move(x)); }
+
+  // Удаляет последний элемент и возвращает его
+  T pop_back() {
+    std::size_t position = start_ + size_ - 1;
+    T *&block = map[position / kBlockSize];
+    T tmp = std::move(block[position % kBlockSize]);
+    block[position % kBlockSize].~T();
+    --size_;
+    if (size_ == 0 || position % kBlockSize == 0) {
+      give_block(std::exchange(block, nullptr));
+    }
+    return tmp;
+  }
+
+  // Удаляет первый элемент и возвращает его
+  T pop_front() {
+    T *&block = map[start_ / kBlockSize];
+    T tmp = std::move(block[start_ % kBlockSize]);
+    block[start_ % kBlockSize].~T();
+    ++start_;
+    --size_;
+    if (size_ == 0 || start_ % kBlockSize == 0) {
+      give_block(std::exchange(block, nullptr));
+    }
+    return tmp;
+  }
+
+  // Удаляет все элементы; один блок остается запасным
+  void clear() {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+      for (T &item : *this) {
+        item.~T();
+      }
+    }
+    if (size_) {
+      for (std::size_t block = start_ / kBlockSize; block <= (start_ + size_ - 1) / kBlockSize; ++block) {
+        give_block(std::exchange(map[block], nullptr));
+      }
+    }
+    size_ = 0;
+  }
+
+  iterator begin() { return make_iterator<false>(start_); }
+  iterator end() { return make_iterator<false>(start_ + size_); }
+  const_iterator begin() const { return make_iterator<true>(start_); }
+  const_iterator end() const { return make_iterator<true>(start_ + size_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // Вызывает f(first, last) для каждого непрерывного куска элементов по
+  // порядку. Внутренний цикл по указателям компилятор векторизует так же,
+  // как цикл по массиву
+  template <class F> void for_each_block(F f) {
+    std::size_t position = start_, end = start_ + size_;
+    while (position < end) {
+      std::size_t block_end = std::min(end, (position / kBlockSize + 1) * kBlockSize);
+      T *block = map[position / kBlockSize];
+      f(block + position % kBlockSize, block + (block_end - 1) % kBlockSize + 1);
+      position = block_end;
+    }
+  }
+
+private:
+  template <bool Const> Iter<Const> make_iterator(std::size_t position) const {
+    if (size_ == 0) {
+      return Iter<Const>();
+    }
+    T *const *node = map.data() + position / kBlockSize;
+    T *cur = *node ? *node + position % kBlockSize : nullptr;
+    return Iter<Const>(const_cast<typename Iter<Const>::Block>(node), cur);
+  }
+};
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "deque.h"
+
+template <class T> bool same(const Deque<T> &deque, const std::deque<T> &expected) {
+  return deque.size() == expected.size() &&
+         std::equal(deque.begin(), deque.end(), expected.begin(), expected.end());
+}
+
+void test_matches_std_deque() {
+  Deque<int> deque;
+  std::deque<int> expected;
+  unsigned seed = 1;
+  for (int i = 0; i < 200000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    // сначала растет, потом в основном убывает
+    int op = (seed >> 16) % (i < 100000 ? 5 : 7);
+    if (op < 2 || expected.empty()) {
+      deque.push_back(i);
+      expected.push_back(i);
+    } else if (op < 4) {
+      deque.push_front(i);
+      expected.push_front(i);
+    } else if (op % 2) {
+      assert(deque.pop_back() == expected.back());
+      expected.pop_back();
+    } else {
+      assert(deque.pop_front() == expected.front());
+      expected.pop_front();
+    }
+    assert(deque.size() == expected.size());
+    if (!expected.empty()) {
+      assert(deque.front() == expected.front() && deque.back() == expected.back());
+      std::size_t middle = expected.size() / 2;
+      assert(deque[middle] == expected[middle]);
+    }
+  }
+  assert(same(deque, expected));
+}
+
+void test_stable_addresses() {
+  Deque<std::string> deque;
+  deque.push_back("anchor");
+  const std::string *anchor = &deque.front();
+  for (int i = 0; i < 100000; ++i) {
+    deque.push_back(std::to_string(i));
+    deque.push_front(std::to_string(-i));
+  }
+  assert(&deque[100000] == anchor && *anchor == "anchor");
+  for (int i = 0; i < 100000; ++i) {
+    deque.pop_front();
+  }
+  assert(&deque.front() == anchor && deque.size() == 100001);
+  assert(deque.back() == "99999");
+}
+
+void test_iterators() {
+  Deque<int> deque;
+  std::deque<int> expected;
+  for (int i = 0; i < 5000; ++i) {
+    int value = (i * 7919) % 5000;
+    deque.push_front(value);
+    expected.push_front(value);
+  }
+  std::sort(deque.begin(), deque.end());
+  std::sort(expected.begin(), expected.end());
+  assert(same(deque, expected));
+
+  auto first = deque.begin();
+  assert(deque.end() - first == 5000 && first + 5000 == deque.end());
+  assert(first[1234] == 1234 && *(first + 4999) == 4999);
+  auto it = first + 3000;
+  it -= 2500;
+  assert(*it == 500 && it - first == 500 && first < it && it <= deque.end());
+  --it;
+  assert(*it-- == 499 && *it == 498);
+  assert(*(deque.end() - 1) == 4999 && *--deque.end() == 4999);
+  assert(*deque.rbegin() == 4999 && deque.rend() - deque.rbegin() == 5000);
+
+  const Deque<int> &view = deque;
+  Deque<int>::const_iterator converted = deque.begin();
+  assert(converted == view.begin() && std::accumulate(view.begin(), view.end(), 0) == 4999 * 5000 / 2);
+  assert(std::lower_bound(view.begin(), view.end(), 4321) - view.begin() == 4321);
+
+  Deque<int> empty;
+  assert(empty.begin() == empty.end() && empty.end() - empty.begin() == 0);
+  std::sort(empty.begin(), empty.end());
+  empty.push_back(1);
+  empty.pop_back();
+  assert(empty.begin() == empty.end() && empty.empty());
+}
+
+// Считает живые объекты; конструктор из числа меньше нуля бросает
+struct Counted {
+  static inline int alive = 0;
+  int value;
+
+  Counted(int value_) : value(value_) {
+    if (value < 0) {
+      throw std::runtime_error("negative");
+    }
+    ++alive;
+  }
+  Counted(const Counted &other) : value(other.value) { ++alive; }
+  ~Counted() { --alive; }
+};
+
+void test_lifetime_and_exceptions() {
+  Counted::alive = 0;
+  {
+    Deque<Counted> deque;
+    for (std::size_t i = 0; i < Deque<Counted>::kBlockSize; ++i) {
+      deque.emplace_back(int(i));
+    }
+    // следующий элемент начал бы новый блок с обеих сторон
+    bool thrown_back = false, thrown_front = false;
+    try {
+      deque.emplace_back(-1);
+    } catch (const std::runtime_error &) {
+      thrown_back = true;
+    }
+    try {
+      deque.emplace_front(-1);
+    } catch (const std::runtime_error &) {
+      thrown_front = true;
+    }
+    assert(thrown_back && thrown_front && deque.size() == Deque<Counted>::kBlockSize);
+    assert(Counted::alive == int(deque.size()));
+    deque.emplace_front(100);
+    deque.emplace_back(200);
+    assert(deque.front().value == 100 && deque.back().value == 200);
+
+    Deque<Counted> copied(deque);
+    assert(Counted::alive == 2 * int(deque.size()) && copied[1].value == 0);
+    Deque<Counted> moved(std::move(copied));
+    assert(copied.empty() && moved.size() == deque.size());
+    moved.swap(copied);
+    assert(moved.empty() && copied.back().value == 200);
+    copied = deque;
+    moved = std::move(copied);
+    assert(Counted::alive == 2 * int(deque.size()));
+    moved.clear();
+    assert(moved.empty() && Counted::alive == int(deque.size()));
+    moved.push_back(Counted(5));
+    assert(moved.front().value == 5);
+  }
+  assert(Counted::alive == 0);
+
+  Deque<std::string> strings{"a", "b", "c"};
+  assert(strings.size() == 3 && strings[1] == "b");
+}
+
+void test_for_each_block() {
+  Deque<long long> deque;
+  for (int i = 0; i < 10000; ++i) {
+    deque.push_back(i);
+    deque.push_front(-i);
+  }
+  long long sum = 0;
+  std::size_t count = 0;
+  deque.for_each_block([&](long long *first, long long *last) {
+    assert(last - first <= std::ptrdiff_t(Deque<long long>::kBlockSize));
+    count += last - first;
+    sum += std::accumulate(first, last, 0ll);
+  });
+  assert(count == deque.size() && sum == 0);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Миллисекунды между двумя отметками Clock
+double ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Очередь: n push и n pop при длине очереди около 1000; полный проход по n
+// элементам. Запуск: ./main bench [n]
+void bench(int n) {
+  auto queue = [n](auto container) {
+    long long sum = 0;
+    for (int i = 0; i < n; ++i) {
+      container.push_back(i);
+      if (container.size() > 1000) {
+        sum += container.front();
+        container.pop_front();
+      }
+    }
+    return sum;
+  };
+  auto start = Clock::now();
+  long long deque_sum = queue(Deque<int>());
+  auto deque_done = Clock::now();
+  long long std_deque_sum = queue(std::deque<int>());
+  auto std_deque_done = Clock::now();
+  long long list_sum = queue(std::list<int>());
+  auto list_done = Clock::now();
+  assert(deque_sum == std_deque_sum && deque_sum == list_sum);
+  std::cout << "queue of ~1000 ints, " << n << " push+pop: Deque " << ms(start, deque_done)
+            << " ms, std::deque " << ms(deque_done, std_deque_done) << " ms, std::list "
+            << ms(std_deque_done, list_done) << " ms" << std::endl;
+
+  // рост: Deque не переносит элементы, std::vector переносит при каждом удвоении
+  start = Clock::now();
+  Deque<std::string> deque;
+  for (int i = 0; i < n; ++i) {
+    deque.push_back(std::string(32, 'a'));
+  }
+  auto deque_grown = Clock::now();
+  std::vector<std::string> vector;
+  for (int i = 0; i < n; ++i) {
+    vector.push_back(std::string(32, 'a'));
+  }
+  auto vector_grown = Clock::now();
+  std::cout << "push_back " << n << " strings: Deque " << ms(start, deque_grown)
+            << " ms, std::vector " << ms(deque_grown, vector_grown) << " ms" << std::endl;
+
+  Deque<int> numbers;
+  std::vector<int> contiguous;
+  for (int i = 0; i < n; ++i) {
+    numbers.push_back(i % 1000);
+    contiguous.push_back(i % 1000);
+  }
+  start = Clock::now();
+  long long iterated = 0;
+  for (int x : numbers) {
+    iterated += x;
+  }
+  auto iterated_done = Clock::now();
+  long long blocks = 0;
+  numbers.for_each_block([&](const int *first, const int *last) {
+    for (; first != last; ++first) {
+      blocks += *first;
+    }
+  });
+  auto blocks_done = Clock::now();
+  long long flat = 0;
+  for (int x : contiguous) {
+    flat += x;
+  }
+  auto flat_done = Clock::now();
+  assert(iterated == flat && blocks == flat);
+  std::cout << "sum of " << n << " ints: Deque iterator " << ms(start, iterated_done)
+            << " ms, Deque for_each_block " << ms(iterated_done, blocks_done)
+            << " ms, std::vector " << ms(blocks_done, flat_done) << " ms (" << flat << ")"
+            << std::endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    bench(argc > 2 ? std::stoi(argv[2]) : 1000000);
+    return 0;
+  }
+  test_matches_std_deque();
+  test_stable_addresses();
+  test_iterators();
+  test_lifetime_and_exceptions();
+  test_for_each_block();
+  std::cout << "Deque: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,8 @@
+{ pkgs }: {
+	deps = [
+		pkgs.clang_12
+		pkgs.ccls
+		pkgs.gdb
+		pkgs.gnumake
+	];
+}
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include <iostream>  
 #include <initializer_list>
+#include <chrono>
+#include <list>
+#include <string>
+#include <type_traits>
+
+#include "../NodePool/node_pool.h"
 
 template <class T>
 class List {
@@ -19,6 +25,9 @@ private:
 
   std::size_t size_=0;
 
+  // узлы берутся из пула блоками подряд, удаленные переиспользуются
+  NodePool<node> pool;
+
 public:
   class Iterator;
   // Создает список размера count заполненный дефолтными значениями типа T
@@ -40,7 +49,7 @@ public:
   List(const List& other){
     node *tmp = other.head;
     while(tmp!=0){
-      push_back(tmp->data);
+      push_back(tmp->value);
       tmp=tmp->next;
     }
     size_=other.size_;
@@ -58,7 +67,7 @@ public:
       for(int i=0; i<list_size; ++i){
         pop_back();
       }
-      delete head;
+      pool.destroy(head);
       size_=0;
       node *tmp= other.head;
       while(tmp!=0){
@@ -70,15 +79,17 @@ public:
     return *this;
   };
   
-  // Очищает память списка [O(n)]
+  // Очищает память списка [O(n)]. Если у T тривиальный деструктор, то
+  // узлы не обходятся: пул отдает свои блоки целиком
   ~List(){
-    while(head!=tail)
-      {
-        node *tmp=head->next;
-        delete head;
-        head=tmp;
-      }
-    delete head;
+    if constexpr (!std::is_trivially_destructible<node>::value){
+      while(head!=nullptr)
+        {
+          node *tmp=head->next;
+          pool.destroy(head);
+          head=tmp;
+        }
+    }
   };
   
   // Возвращает размер списка (сколько памяти уже занято)
@@ -139,7 +150,7 @@ public:
   
   // Добавляет элемент в конец списока.
   void push_back(const T& x){
-    node *tmp = new node(tail,nullptr,x);
+    node *tmp = pool.create(tail,nullptr,x);
     if(tail==nullptr){
       head=tmp;
     }
@@ -152,7 +163,7 @@ public:
   
   // Добавляет элемент в начало списока.
   void push_front(const T& x){
-    node* tmp = new node(nullptr,head,x);
+    node* tmp = pool.create(nullptr,head,x);
     if(head==nullptr){
       tail=tmp;
     }
@@ -174,7 +185,7 @@ public:
     tail = tail->prev;
     tail -> next = nullptr;
     val = tmp->value;
-    delete tmp;
+    pool.destroy(tmp);
     size_--;
     return val;
   };
@@ -191,7 +202,7 @@ public:
     head = head->next;
     head->prev = nullptr;
     val = tmp->value;
-    delete tmp;
+    pool.destroy(tmp);
     size_--;
     return val;
   };
@@ -209,7 +220,7 @@ public:
       push_back(value);
     }
     else{
-      node *tmp = new node(it.current->prev,it.current,value);
+      node *tmp = pool.create(it.current->prev,it.current,value);
       it.current->prev=tmp;
       --it;
       --it;
@@ -236,7 +247,7 @@ public:
     ++it;
     it.current->prev = tmp->prev;
     val = tmp->value;
-    delete tmp;
+    pool.destroy(tmp);
     size_--;
     return val;
   };
@@ -297,7 +308,57 @@ std::ostream& operator<< (std::ostream &out, List<T> &instance){
   return out;
 };
 
-int main() {
+using Clock = std::chrono::steady_clock;
+
+// Миллисекунды между двумя отметками Clock
+double ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// n раз push_back и проход по списку: List с пулом узлов против std::list,
+// где каждый узел - отдельный malloc. Запуск: ./main bench [n]
+template <class T, class Make, class Weight>
+void bench_push_and_scan(int n, const char *name, Make make, Weight weight) {
+  auto run = [&](auto &list, const char *list_name) {
+    auto start = Clock::now();
+    for(int i = 0; i < n; ++i){
+      list.push_back(make(i));
+    }
+    auto pushed = Clock::now();
+    long long total = 0;
+    for(auto it = list.begin(); it != list.end(); ++it){
+      total += weight(*it);
+    }
+    auto scanned = Clock::now();
+    std::cout << name << " " << list_name << ": push_back " << ms(start, pushed)
+              << " ms, scan " << ms(pushed, scanned) << " ms (" << total << ")";
+  };
+  auto start = Clock::now();
+  {
+    List<T> list;
+    run(list, "List");
+    start = Clock::now();
+  }
+  std::cout << ", destroy " << ms(start, Clock::now()) << " ms" << std::endl;
+  {
+    std::list<T> list;
+    run(list, "std::list");
+    start = Clock::now();
+  }
+  std::cout << ", destroy " << ms(start, Clock::now()) << " ms" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    int n = argc > 2 ? std::stoi(argv[2]) : 1000000;
+    bench_push_and_scan<int>(
+        n, "int", [](int i) { return i; }, [](int x) { return x; });
+    bench_push_and_scan<std::string>(
+        n, "string", [](int i) { return std::to_string(i); },
+        [](const std::string &x) { return x.size(); });
+    return 0;
+  }
+
   List<int> list;
   std::cout << list.empty() << std::endl;
   list.push_front(10);
@@ -1,190 +1,619 @@
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <random>
 #include <utility>
+#include <vector>
+
+#include "../NodePool/node_pool.h"
+
+// Можно ли искать ключ K в Map<Key, ...> без создания временного Key: K
+// должен сравниваться с Key через ==, < и > (например const char* и
+// std::string_view с std::string)
+template <class Key, class K, class = void>
+struct is_comparable_with : std::false_type {};
+
+template <class Key, class K>
+struct is_comparable_with<
+    Key, K,
+    std::void_t<decltype(std::declval<const K &>() == std::declval<const Key &>()),
+                decltype(std::declval<const K &>() < std::declval<const Key &>()),
+                decltype(std::declval<const K &>() > std::declval<const Key &>())>>
+    : std::true_type {};
+
+// Метка для конструктора из отсортированного диапазона: ключи строго
+// возрастают, проверять и сортировать ничего не нужно (как std::sorted_unique)
+struct sorted_unique_t {};
+inline constexpr sorted_unique_t sorted_unique{};
+
+// Размер поддерева в узле Map. Без OrderStatistics поле пустое и места в
+// узле не занимает
+template <bool OrderStatistics> struct SubtreeSize {};
+
+template <> struct SubtreeSize<true> {
+  std::size_t subtree_size = 1;
+};
+
+// Map - красно-черное дерево: корень черный, у красного узла оба ребенка
+// черные, на любом пути от узла вниз до nullptr одинаковое число черных
+// узлов. Поэтому высота не больше 2*log2(n + 1) при любом порядке вставки.
+//
+// С OrderStatistics = true каждый узел еще хранит размер своего поддерева,
+// что дает select(k), rank(key) и distance(first, last) за O(log n) ценой
+// одного size_t на узел и его поддержки при вставке, удалении и поворотах.
+template <class Key, class Value, bool OrderStatistics = false> class Map {
+public:
+  class Iterator;
+  class ConstIterator;
 
-template <class Key, class Value> class Map {
 private:
-  struct Node {
+  struct Node : SubtreeSize<OrderStatistics> {
     Node *left;
     Node *right;
     Node *parent;
+    bool red = true; // новый узел всегда красный
     std::pair<Key, Value> pair;
 
-    Node(Node *left_ = nullptr, Node *right_ = nullptr, Node *parent_ = nullptr,
-         Key key = Key{}, Value val = Value{})
-        : left(left_), right(right_), parent(parent_), pair({key, val}) {}
+    // pair создается прямо в узле из args
+    template <class... Args>
+    Node(Node *parent_, Args &&...args)
+        : left(nullptr), right(nullptr), parent(parent_),
+          pair(std::forward<Args>(args)...) {}
   };
 
   Node *root = nullptr;
 
   std::size_t size_ = 0;
 
-  // Мой метод для упрощения copy конструктора
-  void copy_tree(Node *node, Node *node2) {
-    node2->pair = node->pair;
+  // Все узлы берутся из пула: блоками подряд, освобожденные переиспользуются
+  NodePool<Node> pool;
 
-    if (node->left) {
-      Node *tmp = new Node(nullptr, nullptr, node2);
-      node2->left = tmp;
-      copy_tree(node->left, node2->left);
-    }
+  // Копия одного узла без детей: пара, цвет и размер поддерева
+  Node *copy_node(const Node *node, Node *parent) {
+    Node *copy = pool.create(parent, node->pair);
+    copy->red = node->red;
+    static_cast<SubtreeSize<OrderStatistics> &>(*copy) = *node;
+    return copy;
+  }
 
-    if (node->right) {
-      Node *tmp2 = new Node(nullptr, nullptr, node2);
-      node2->right = tmp2;
-      copy_tree(node->right, node2->right);
+  // Мой метод для упрощения copy конструктора. Обходит node и node2
+  // синхронно по parent-указателям без рекурсии: у копии левый (правый)
+  // ребенок появляется ровно тогда, когда левое (правое) поддерево уже
+  // начали копировать, поэтому отдельный стек не нужен.
+  void copy_tree(Node *node, Node *node2) {
+    Node *const top = node;
+    while (true) {
+      if (node->left && !node2->left) {
+        node2->left = copy_node(node->left, node2);
+        node = node->left;
+        node2 = node2->left;
+      } else if (node->right && !node2->right) {
+        node2->right = copy_node(node->right, node2);
+        node = node->right;
+        node2 = node2->right;
+      } else if (node != top) {
+        node = node->parent;
+        node2 = node2->parent;
+      } else {
+        return;
+      }
     }
   }
 
   // Мой метод поиска =)
-  Node *search(const Key &key, Node *node) {
-    if (node == nullptr) {
-      return nullptr;
+  // K - Key или тип, сравнимый с Key (см. is_comparable_with)
+  template <class K> Node *search(const K &key, Node *node) const {
+    while (node) {
+      if (key < node->pair.first) {
+        node = node->left;
+      } else if (key > node->pair.first) {
+        node = node->right;
+      } else {
+        return node;
+      }
     }
+    return nullptr;
+  }
 
-    if (key == node->pair.first) {
-      return node;
+  // Мой метод очистки. Спускается до листа, удаляет его и поднимается к
+  // родителю, поэтому память не зависит от высоты дерева
+  void clearup(Node *node) {
+    if (node == nullptr) {
+      return;
     }
-
-    if (key < node->pair.first && node->left) {
-      return search(key, node->left);
+    Node *const stop = node->parent;
+    while (node != stop) {
+      if (node->left) {
+        node = node->left;
+      } else if (node->right) {
+        node = node->right;
+      } else {
+        Node *parent = node->parent;
+        if (parent != stop) {
+          (parent->left == node ? parent->left : parent->right) = nullptr;
+        }
+        pool.destroy(node);
+        node = parent;
+      }
     }
+  }
 
-    if (key > node->pair.first && node->right) {
-      return search(key, node->right);
-    }
+  // Метод которы отвязывает наследника от родителая
+  void unlinkparent(Node *node) {
+    if (node->parent) {
+      if (node->pair.first > node->parent->pair.first) {
+        node->parent->right = nullptr;
+      } else if (node->pair.first < node->parent->pair.first) {
+        node->parent->left = nullptr;
+      }
 
-    return nullptr;
+      node->parent = nullptr;
+    } else {
+      throw std::out_of_range("Error!!!");
+    }
   }
 
-  // Тот же метод что и search только константный.
-  const Node *search(const Key &key, Node *node) const {
-    if (node == nullptr) {
-      return nullptr;
+  // Первый узел с ключом не меньше key (strict = false) или строго больше
+  // key (strict = true), nullptr если такого нет. Один спуск [O(log n)]
+  template <class K> Node *bound(const K &key, bool strict) const {
+    Node *result = nullptr;
+    Node *node = root;
+    while (node) {
+      if (key < node->pair.first || (!strict && !(key > node->pair.first))) {
+        result = node;
+        node = node->left;
+      } else {
+        node = node->right;
+      }
     }
+    return result;
+  }
 
-    if (key == node->pair.first) {
+  // Следующий по порядку узел. Поднимаемся, пока приходим из правого
+  // поддерева; ключи не сравниваются
+  static Node *successor(Node *node) {
+    if (node->right) {
+      node = node->right;
+      while (node->left) {
+        node = node->left;
+      }
       return node;
     }
+    while (node->parent && node == node->parent->right) {
+      node = node->parent;
+    }
+    return node->parent;
+  }
 
-    if (key < node->pair.first && node->left) {
-      return search(key, node->left);
+  // Зеркально successor
+  static Node *predecessor(Node *node) {
+    if (node->left) {
+      node = node->left;
+      while (node->right) {
+        node = node->right;
+      }
+      return node;
     }
+    while (node->parent && node == node->parent->left) {
+      node = node->parent;
+    }
+    return node->parent;
+  }
 
-    if (key > node->pair.first && node->right) {
-      return search(key, node->right);
+  // Самый правый узел поддерева, с него начинается --end()
+  static Node *rightmost(Node *node) {
+    while (node && node->right) {
+      node = node->right;
     }
+    return node;
+  }
 
-    return nullptr;
+  // Глубина (корень - 1), на которой в дереве из count узлов, построенном
+  // делением пополам, начинается неполный последний уровень
+  static std::size_t red_depth(std::size_t count) {
+    std::size_t full_levels = 0;
+    while ((std::size_t(2) << full_levels) - 1 <= count) {
+      ++full_levels;
+    }
+    return full_levels + 1;
   }
 
-  // Тот же search но через цикл
-  Node *searchCycle(const Key &key, Node *node) {
-    if (node == nullptr) {
+  // Строит дерево из count элементов начиная с first: левая половина,
+  // середина, правая половина, каждый элемент читается ровно один раз [O(n)].
+  // Листья получаются на двух последних уровнях; узлы неполного последнего
+  // уровня красные, остальные черные, поэтому черная высота всех путей
+  // одинакова. Глубина рекурсии - log2(count). Узлы создаются в памяти
+  // slot, slot + 1, ... в порядке ключей, так что обход идет по памяти подряд
+  template <class It>
+  static Node *build_sorted(It &first, std::size_t count, std::size_t depth,
+                            std::size_t red_at, Node *parent, Node *&slot) {
+    if (count == 0) {
       return nullptr;
     }
+    std::size_t left_count = count / 2;
+    Node *left =
+        build_sorted(first, left_count, depth + 1, red_at, nullptr, slot);
+    Node *node = new (slot++) Node(parent, *first);
+    ++first;
+    node->red = depth == red_at;
+    node->left = left;
+    if (left) {
+      left->parent = node;
+    }
+    node->right = build_sorted(first, count - left_count - 1, depth + 1,
+                               red_at, node, slot);
+    if constexpr (OrderStatistics) {
+      node->subtree_size = count;
+    }
+    return node;
+  }
 
-    if (key == node->pair.first) {
-      return node;
+  // То же, но левое поддерево строится в отдельном потоке, пока текущий
+  // строит правое. Потоки делятся пополам на каждом уровне, мелкие
+  // поддеревья строятся последовательно. Место каждого узла в slots
+  // известно заранее (его номер по порядку), поэтому потоки пишут в разные
+  // участки памяти без синхронизации
+  template <class It>
+  static Node *build_sorted_parallel(It first, std::size_t count,
+                                     std::size_t depth, std::size_t red_at,
+                                     Node *parent, Node *slots,
+                                     unsigned threads) {
+    if (threads <= 1 || count < (1 << 16)) {
+      return build_sorted(first, count, depth, red_at, parent, slots);
     }
+    std::size_t left_count = count / 2;
+    Node *left = nullptr;
+    std::thread worker([&] {
+      left = build_sorted_parallel(first, left_count, depth + 1, red_at,
+                                   nullptr, slots, threads / 2);
+    });
+    It middle = first + left_count;
+    Node *node = new (slots + left_count) Node(parent, *middle);
+    node->red = depth == red_at;
+    node->right = build_sorted_parallel(middle + 1, count - left_count - 1,
+                                        depth + 1, red_at, node,
+                                        slots + left_count + 1,
+                                        threads - threads / 2);
+    worker.join();
+    node->left = left;
+    left->parent = node;
+    if constexpr (OrderStatistics) {
+      node->subtree_size = count;
+    }
+    return node;
+  }
 
-    while (node->left || node->right) {
-      if (key < node->pair.first && node->left) {
-        node = node->left;
-        if (key == node->pair.first) {
-          return node;
-        }
-        continue;
-      } else if (key > node->pair.first && node->right) {
-        node = node->right;
-        if (key == node->pair.first) {
-          return node;
-        }
-        continue;
-      } else {
-        break;
+  // Один спуск по дереву: возвращает узел с ключом key, а если его нет, то
+  // nullptr и в parent - узел, к которому надо подвесить новый ключ
+  template <class K> Node *find_or_parent(const K &key, Node *&parent) {
+    parent = nullptr;
+    Node *node = root;
+    while (node) {
+      if (key == node->pair.first) {
+        return node;
       }
+      parent = node;
+      node = key < node->pair.first ? node->left : node->right;
     }
-
     return nullptr;
   }
 
-  // Мой метод очистки
-  void clearup(Node *node) {
-    if (node == nullptr) {
-      return;
+  static bool is_red(const Node *node) { return node != nullptr && node->red; }
+
+  static std::size_t subtree_size(const Node *node) {
+    return node ? node->subtree_size : 0;
+  }
+
+  // Пересчитывает размер поддерева node по детям
+  static void update_size(Node *node) {
+    if constexpr (OrderStatistics) {
+      node->subtree_size =
+          1 + subtree_size(node->left) + subtree_size(node->right);
     }
+  }
 
-    if (node->left) {
-      clearup(node->left);
+  // Прибавляет delta к размерам поддеревьев от node до корня
+  static void add_to_sizes(Node *node, int delta) {
+    if constexpr (OrderStatistics) {
+      for (; node; node = node->parent) {
+        node->subtree_size += delta;
+      }
     }
+  }
 
-    if (node->right) {
-      clearup(node->right);
+  // Левый поворот: правый ребенок y встает на место x, x становится левым
+  // ребенком y, а бывшее левое поддерево y - правым поддеревом x
+  void rotate_left(Node *x) {
+    Node *y = x->right;
+    x->right = y->left;
+    if (y->left) {
+      y->left->parent = x;
     }
+    replace_child(x, y);
+    y->left = x;
+    x->parent = y;
+    update_size(x);
+    update_size(y);
+  }
 
-    delete node;
+  // Зеркально rotate_left
+  void rotate_right(Node *x) {
+    Node *y = x->left;
+    x->left = y->right;
+    if (y->right) {
+      y->right->parent = x;
+    }
+    replace_child(x, y);
+    y->right = x;
+    x->parent = y;
+    update_size(x);
+    update_size(y);
   }
 
-  // Метод которы отвязывает наследника от родителая
-  void unlinkparent(Node *node) {
-    if (node->parent) {
-      if (node->pair.first > node->parent->pair.first) {
-        node->parent->right = nullptr;
-      } else if (node->pair.first < node->parent->pair.first) {
-        node->parent->left = nullptr;
-      }
+  // Ставит поддерево v на место поддерева u у родителя u
+  void replace_child(Node *u, Node *v) {
+    if (u->parent == nullptr) {
+      root = v;
+    } else if (u == u->parent->left) {
+      u->parent->left = v;
+    } else {
+      u->parent->right = v;
+    }
+    if (v) {
+      v->parent = u->parent;
+    }
+  }
 
-      node->parent = nullptr;
+  // Подвешивает новый узел к parent (nullptr - дерево пустое) и
+  // восстанавливает балансировку [O(log n)]
+  void attach(Node *node, Node *parent) {
+    node->parent = parent;
+    if (parent == nullptr) {
+      root = node;
+    } else if (node->pair.first < parent->pair.first) {
+      parent->left = node;
     } else {
-      throw std::out_of_range("Error!!!");
+      parent->right = node;
     }
+    add_to_sizes(parent, 1);
+    size_++;
+    insert_fixup(node);
   }
 
-  // Метод который похож на search, но он ищет ближайщий
-  // parent key-а и возврощает этот самый parent
-  Node *FindPossibleParent(const Key &key, Node *node) {
-    if (node == nullptr) {
-      return nullptr;
+  // После вставки красного node нарушено может быть только правило "у
+  // красного узла черные дети": перекрашиваем, пока дядя красный, иначе
+  // одним-двумя поворотами
+  void insert_fixup(Node *node) {
+    while (is_red(node->parent)) {
+      Node *parent = node->parent;
+      Node *grand = parent->parent; // есть, т.к. красный parent не корень
+      if (parent == grand->left) {
+        Node *uncle = grand->right;
+        if (is_red(uncle)) {
+          parent->red = false;
+          uncle->red = false;
+          grand->red = true;
+          node = grand;
+          continue;
+        }
+        if (node == parent->right) {
+          rotate_left(parent);
+          node = parent;
+          parent = node->parent;
+        }
+        parent->red = false;
+        grand->red = true;
+        rotate_right(grand);
+      } else {
+        Node *uncle = grand->left;
+        if (is_red(uncle)) {
+          parent->red = false;
+          uncle->red = false;
+          grand->red = true;
+          node = grand;
+          continue;
+        }
+        if (node == parent->left) {
+          rotate_right(parent);
+          node = parent;
+          parent = node->parent;
+        }
+        parent->red = false;
+        grand->red = true;
+        rotate_left(grand);
+      }
     }
+    root->red = false;
+  }
 
-    if (key < node->pair.first && node->left == nullptr) {
-      return node;
+  // Вынимает node из дерева (узлы перевешиваются, а не меняются парами,
+  // поэтому итераторы на остальные элементы остаются валидными) [O(log n)]
+  void erase_node(Node *node) {
+    Node *removed = node; // узел, который реально пропадает из своего места
+    bool removed_red = removed->red;
+    Node *child;          // кто встал на место removed
+    Node *child_parent;
+
+    if (node->left == nullptr) {
+      add_to_sizes(node->parent, -1);
+      child = node->right;
+      child_parent = node->parent;
+      replace_child(node, node->right);
+    } else if (node->right == nullptr) {
+      add_to_sizes(node->parent, -1);
+      child = node->left;
+      child_parent = node->parent;
+      replace_child(node, node->left);
+    } else {
+      // два ребенка - на место node встает следующий за ним узел
+      removed = node->right;
+      while (removed->left) {
+        removed = removed->left;
+      }
+      // из своего места пропадает removed: путь от него вверх проходит и
+      // через node, чей размер потом достанется removed
+      add_to_sizes(removed->parent, -1);
+      removed_red = removed->red;
+      child = removed->right;
+      if (removed->parent == node) {
+        child_parent = removed;
+      } else {
+        child_parent = removed->parent;
+        replace_child(removed, removed->right);
+        removed->right = node->right;
+        removed->right->parent = removed;
+      }
+      replace_child(node, removed);
+      removed->left = node->left;
+      removed->left->parent = removed;
+      removed->red = node->red;
+      if constexpr (OrderStatistics) {
+        removed->subtree_size = node->subtree_size;
+      }
     }
 
-    if (key > node->pair.first && node->right == nullptr) {
-      return node;
+    pool.destroy(node);
+    size_--;
+    if (!removed_red) {
+      erase_fixup(child, child_parent);
     }
+  }
 
-    if (key < node->pair.first && node->left) {
-      return FindPossibleParent(key, node->left);
+  // Убрали черный узел: на пути через child не хватает одного черного.
+  // child может быть nullptr, поэтому его родитель передается отдельно.
+  void erase_fixup(Node *child, Node *parent) {
+    while (child != root && !is_red(child)) {
+      if (child == parent->left) {
+        Node *brother = parent->right; // не nullptr: с его стороны черная высота больше
+        if (is_red(brother)) {
+          brother->red = false;
+          parent->red = true;
+          rotate_left(parent);
+          brother = parent->right;
+        }
+        if (!is_red(brother->left) && !is_red(brother->right)) {
+          brother->red = true;
+          child = parent;
+          parent = child->parent;
+          continue;
+        }
+        if (!is_red(brother->right)) {
+          brother->left->red = false;
+          brother->red = true;
+          rotate_right(brother);
+          brother = parent->right;
+        }
+        brother->red = parent->red;
+        parent->red = false;
+        brother->right->red = false;
+        rotate_left(parent);
+        child = root;
+      } else {
+        Node *brother = parent->left;
+        if (is_red(brother)) {
+          brother->red = false;
+          parent->red = true;
+          rotate_right(parent);
+          brother = parent->left;
+        }
+        if (!is_red(brother->left) && !is_red(brother->right)) {
+          brother->red = true;
+          child = parent;
+          parent = child->parent;
+          continue;
+        }
+        if (!is_red(brother->left)) {
+          brother->right->red = false;
+          brother->red = true;
+          rotate_left(brother);
+          brother = parent->left;
+        }
+        brother->red = parent->red;
+        parent->red = false;
+        brother->left->red = false;
+        rotate_right(parent);
+        child = root;
+      }
+    }
+    if (child) {
+      child->red = false;
     }
+  }
 
-    if (key > node->pair.first && node->right) {
-      return FindPossibleParent(key, node->right);
+  // Если ключа нет, то создает узел: ключ из key, значение прямо в узле из args
+  template <class K, class... Args>
+  std::pair<Iterator, bool> try_emplace_key(K &&key, Args &&...args) {
+    Node *parent;
+    Node *node = find_or_parent(key, parent);
+    if (node) {
+      return {Iterator(node, this), false};
     }
-    return nullptr;
+    node = pool.create(parent, std::piecewise_construct,
+                    std::forward_as_tuple(std::forward<K>(key)),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+    attach(node, parent);
+    return {Iterator(node, this), true};
+  }
+
+  template <class K>
+  using EnableIfComparable =
+      std::enable_if_t<!std::is_same<std::decay_t<K>, Key>::value &&
+                       is_comparable_with<Key, K>::value>;
+
+  // Удаление по ключу, общее для Key и сравнимых с ним типов
+  template <class K> bool erase_key(const K &key) {
+    Node *node = search(key, root);
+    if (node == nullptr) {
+      return false;
+    }
+    erase_node(node);
+    return true;
   }
 
 public:
-  class Iterator;
-  class ConstIterator;
   // Создает пустой словарь
   Map() : root(nullptr) {}
 
-  // Конструктор для initializer_list
+  // Конструктор для initializer_list. Если ключи уже строго возрастают, то
+  // дерево строится за O(n) через assign_sorted
   Map(std::initializer_list<std::pair<Key, Value>> other) {
-    Map<Key, Value> map;
+    auto greater_or_equal = [](const std::pair<Key, Value> &a,
+                               const std::pair<Key, Value> &b) {
+      return !(a.first < b.first);
+    };
+    if (std::adjacent_find(other.begin(), other.end(), greater_or_equal) ==
+        other.end()) {
+      assign_sorted(other.begin(), other.end());
+      return;
+    }
+    Map map;
     for (auto &value : other) {
       map[value.first] = value.second;
     }
     swap(map);
   }
 
+  // Строит словарь из диапазона пар со строго возрастающими ключами [O(n)]
+  //  std::vector<std::pair<int, int>> rows = load_sorted();
+  //  Map<int, int> map(sorted_unique, rows.begin(), rows.end());
+  template <class It> Map(sorted_unique_t, It first, It last) {
+    assign_sorted(first, last);
+  }
+
   // Создает новый словарь, являющийся глубокой копией other [O(n)]
   //  Map<std::string, int> map;
   //  map["something"] = 69;
@@ -193,7 +622,7 @@ public:
   //  copied["something"] == map["something"] == 69
   Map(const Map &other) {
     if (other.root) {
-      root = new Node(nullptr, nullptr, nullptr);
+      root = copy_node(other.root, nullptr);
       copy_tree(other.root, root);
       size_ = other.size_;
     } else {
@@ -201,17 +630,13 @@ public:
     }
   };
 
-  // Move конструктор
-  Map(Map &&other) {
-    std::swap(root, other.root);
-    std::swap(size_, other.size_);
-  };
+  // Move конструктор (узлы уходят вместе с пулом)
+  Map(Map &&other) { swap(other); };
 
   // Перезаписывает текущий словарь словарем other
   Map &operator=(const Map &other) {
     Map tmp{other};
-    std::swap(root, tmp.root);
-    std::swap(size_, tmp.size_);
+    swap(tmp);
 
     return *this;
   };
@@ -219,8 +644,7 @@ public:
   // Присвоивание перемещением
   Map &operator=(Map &&other) {
     Map tmp{std::move(other)};
-    std::swap(root, tmp.root);
-    std::swap(size_, tmp.size_);
+    swap(tmp);
 
     return *this;
   };
@@ -235,9 +659,9 @@ public:
       while (tmp->left) {
         tmp = tmp->left;
       }
-      return Iterator(tmp);
+      return Iterator(tmp, this);
     }
-    return Iterator(nullptr);
+    return Iterator(nullptr, this);
   };
 
   // Возвращает const итератор на первый элемент
@@ -247,27 +671,183 @@ public:
       while (tmp->left) {
         tmp = tmp->left;
       }
-      return ConstIterator(tmp);
+      return ConstIterator(Iterator(tmp, const_cast<Map *>(this)));
     }
-    return ConstIterator(nullptr);
+    return ConstIterator(Iterator(nullptr, const_cast<Map *>(this)));
   };
 
   // Возвращает итератор обозначающий конец контейнера
   Iterator end() {
-    return Iterator(nullptr);
+    return Iterator(nullptr, this);
   };
 
   // Возвращает const итератор обозначающий конец контейнера
   ConstIterator end() const {
-    return ConstIterator(nullptr);
+    return ConstIterator(Iterator(nullptr, const_cast<Map *>(this)));
   };
 
   // Возвращает размер словаря (сколько есть узлов)
   std::size_t size() const { return size_; };
 
+  // Высота дерева (0 для пустого), нужна для проверки балансировки [O(n)]
+  std::size_t height() const {
+    std::size_t result = 0;
+    std::vector<std::pair<const Node *, std::size_t>> stack;
+    if (root) {
+      stack.push_back({root, 1});
+    }
+    while (!stack.empty()) {
+      auto [node, depth] = stack.back();
+      stack.pop_back();
+      result = std::max(result, depth);
+      if (node->left) {
+        stack.push_back({node->left, depth + 1});
+      }
+      if (node->right) {
+        stack.push_back({node->right, depth + 1});
+      }
+    }
+    return result;
+  }
+
+  // Заменяет содержимое парами из [first, last), ключи в которых строго
+  // возрастают. Дерево сразу получается идеально сбалансированным, без
+  // поворотов и сравнений ключей [O(n)]
+  template <class It> void assign_sorted(It first, It last) {
+    Map tmp;
+    tmp.size_ = std::distance(first, last);
+    Node *slot = tmp.pool.allocate_contiguous(tmp.size_);
+    tmp.root =
+        build_sorted(first, tmp.size_, 1, red_depth(tmp.size_), nullptr, slot);
+    swap(tmp);
+  }
+
+  // То же на threads потоках; нужны итераторы произвольного доступа
+  template <class It>
+  void assign_sorted_parallel(It first, It last,
+                              unsigned threads = std::thread::hardware_concurrency()) {
+    Map tmp;
+    tmp.size_ = last - first;
+    tmp.root = build_sorted_parallel(first, tmp.size_, 1, red_depth(tmp.size_),
+                                     nullptr,
+                                     tmp.pool.allocate_contiguous(tmp.size_),
+                                     threads);
+    swap(tmp);
+  }
+
+  // Проверяет свойства красно-черного дерева: корень черный, у красного узла
+  // нет красных детей, черная высота всех путей одинакова. С OrderStatistics
+  // еще и размеры поддеревьев. Для тестов [O(n)]
+  bool is_red_black() const {
+    if (is_red(root)) {
+      return false;
+    }
+    std::vector<std::pair<const Node *, std::size_t>> stack;
+    if (root) {
+      stack.push_back({root, 1});
+    }
+    std::size_t black_height = 0;
+    while (!stack.empty()) {
+      auto [node, blacks] = stack.back();
+      stack.pop_back();
+      if (node->red && (is_red(node->left) || is_red(node->right))) {
+        return false;
+      }
+      if constexpr (OrderStatistics) {
+        if (node->subtree_size !=
+            1 + subtree_size(node->left) + subtree_size(node->right)) {
+          return false;
+        }
+      }
+      for (const Node *child : {node->left, node->right}) {
+        if (child) {
+          stack.push_back({child, blacks + !child->red});
+        } else if (black_height == 0) {
+          black_height = blacks;
+        } else if (black_height != blacks) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Итератор на k-й по возрастанию элемент (с нуля) или end() [O(log n)]
+  //  Map<int, int, true> latency = ...;
+  //  auto p99 = latency.select(latency.size() * 99 / 100);
+  Iterator select(std::size_t k) {
+    static_assert(OrderStatistics, "select requires Map<Key, Value, true>");
+    Node *node = root;
+    while (node) {
+      std::size_t left = subtree_size(node->left);
+      if (k < left) {
+        node = node->left;
+      } else if (k == left) {
+        return Iterator(node, this);
+      } else {
+        k -= left + 1;
+        node = node->right;
+      }
+    }
+    return end();
+  }
+
+  // Сколько ключей меньше key [O(log n)]
+  std::size_t rank(const Key &key) const {
+    static_assert(OrderStatistics, "rank requires Map<Key, Value, true>");
+    std::size_t result = 0;
+    Node *node = root;
+    while (node) {
+      if (key > node->pair.first) {
+        result += subtree_size(node->left) + 1;
+        node = node->right;
+      } else {
+        node = node->left;
+      }
+    }
+    return result;
+  }
+
+  // Номер элемента, на который указывает it (end() - size()) [O(log n)]
+  std::size_t index_of(ConstIterator it) const {
+    static_assert(OrderStatistics, "index_of requires Map<Key, Value, true>");
+    Node *node = it.it.node;
+    if (node == nullptr) {
+      return size_;
+    }
+    std::size_t result = subtree_size(node->left);
+    for (; node->parent; node = node->parent) {
+      if (node == node->parent->right) {
+        result += subtree_size(node->parent->left) + 1;
+      }
+    }
+    return result;
+  }
+
+  // То же, что std::distance(first, last), но за O(log n), а не O(n)
+  std::ptrdiff_t distance(ConstIterator first, ConstIterator last) const {
+    return static_cast<std::ptrdiff_t>(index_of(last)) -
+           static_cast<std::ptrdiff_t>(index_of(first));
+  }
+
   // Проверяет есть ли элемент с таким ключом в контейнере
   bool contains(const Key &key) const { return search(key, root); }
 
+  // Гетерогенный contains: ключ сравнивается с Key напрямую, без создания
+  // временного Key. map.contains(std::string_view{"x"})
+  template <class K, class = EnableIfComparable<K>>
+  bool contains(const K &key) const {
+    return search(key, root);
+  }
+
+  // Возвращает итератор на элемент с таким ключом или end()
+  Iterator find(const Key &key) { return Iterator(search(key, root), this); }
+
+  template <class K, class = EnableIfComparable<K>>
+  Iterator find(const K &key) {
+    return Iterator(search(key, root), this);
+  }
+
   // Возвращает элемент по ключу. Если в словаре нет элемента с таким ключом, то
   // бросает исключение std::out_of_range
   const Value &operator[](const Key &key) const {
@@ -283,36 +863,56 @@ public:
   // словаре нет элемента с таким ключем, то создает его и устанавливает
   // дефолтное значение, после чего возвращает на него ссылку. map["something"]
   // = 75;
-  Value &operator[](const Key &key) {
-    if (root == nullptr) {
-      Node *tmp = new Node(nullptr, nullptr, nullptr, key);
-      root = tmp;
-      size_++;
-      return root->pair.second;
-    }
+  Value &operator[](const Key &key) { return try_emplace_key(key).first->second; };
 
-    Node *tmp = search(key, root);
-    if (tmp) {
-      return tmp->pair.second;
+  // То же, но ключ перемещается в словарь
+  Value &operator[](Key &&key) {
+    return try_emplace_key(std::move(key)).first->second;
+  };
+
+  // Если ключа k нет, то добавляет элемент, значение которого создается прямо
+  // в узле из args (без Value{} и присваивания). Если есть - ничего не делает.
+  template <class... Args>
+  std::pair<Iterator, bool> try_emplace(const Key &k, Args &&...args) {
+    return try_emplace_key(k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<Iterator, bool> try_emplace(Key &&k, Args &&...args) {
+    return try_emplace_key(std::move(k), std::forward<Args>(args)...);
+  }
+
+  // Создает пару из args прямо в новом узле и подвешивает его, если такого
+  // ключа еще нет (иначе узел удаляется)
+  template <class... Args> std::pair<Iterator, bool> emplace(Args &&...args) {
+    Node *node = pool.create(nullptr, std::forward<Args>(args)...);
+    Node *parent;
+    Node *existing = find_or_parent(node->pair.first, parent);
+    if (existing) {
+      pool.destroy(node);
+      return {Iterator(existing, this), false};
     }
-    delete tmp;
+    attach(node, parent);
+    return {Iterator(node, this), true};
+  }
 
-    Node *ntmp = FindPossibleParent(key, root);
-    if (ntmp) {
-      Node *node = new Node(nullptr, nullptr, ntmp);
-      node->pair.first = key;
-      size_++;
-      if (key > ntmp->pair.first) {
-        ntmp->right = node;
-        return ntmp->right->pair.second;
-      } else if (key < ntmp->pair.first) {
-        ntmp->left = node;
-        return ntmp->left->pair.second;
-      }
+  // Добавляет элемент, а если ключ уже есть - присваивает ему obj
+  template <class M>
+  std::pair<Iterator, bool> insert_or_assign(const Key &k, M &&obj) {
+    auto result = try_emplace_key(k, std::forward<M>(obj));
+    if (!result.second) {
+      result.first->second = std::forward<M>(obj);
     }
+    return result;
+  }
 
-    throw std::out_of_range("Error!!!");
-  };
+  template <class M> std::pair<Iterator, bool> insert_or_assign(Key &&k, M &&obj) {
+    auto result = try_emplace_key(std::move(k), std::forward<M>(obj));
+    if (!result.second) {
+      result.first->second = std::forward<M>(obj);
+    }
+    return result;
+  }
 
   // Удаляет элемент по ключу и возвращает значение удаленного элемента
   // Map<int, std::string> c =
@@ -329,80 +929,59 @@ public:
   //
   // В начальном условии метод был const, но в этом случае мы
   // банально не сможем сделать size--.
-  bool erase(const Key &key) {
-    if (size_ == 1) {
-      root = nullptr;
-      size_ = 0;
-      return true;
-    }
-
-    Node* tmp = search(key, root);
+  bool erase(const Key &key) { return erase_key(key); }
 
-    if (tmp != nullptr) {
-      Node *new_tmp = tmp;
-      if (tmp->right) {
-        tmp = tmp->right;
-        while (tmp->left) {
-          tmp = tmp->left;
-        }
-        if (tmp->right) {
-          tmp->parent->left = tmp->right;
-          tmp->right->parent = tmp->parent;
-        }
-      } else if (tmp->left) {
-        tmp = tmp->left;
-        while (tmp->right) {
-          tmp = tmp->right;
-        }
-        if (tmp->left) {
-          tmp->parent->right = tmp->left;
-          tmp->left->parent = tmp->parent;
-        }
-      }
-      std::swap(tmp->pair, new_tmp->pair);
-
-      if (tmp == tmp->parent->left) {
-        tmp->parent->left = nullptr;
-      }
-
-      else if (tmp == tmp->parent->right) {
-        tmp->parent->right = nullptr;
-      }
-
-      delete tmp;
-      size_--;
-      return true;
-    }
-
-    return false;
-  };
+  template <class K, class = EnableIfComparable<K>>
+  bool erase(const K &key) {
+    return erase_key(key);
+  }
 
   // Меняет текуший контейнер с контейнером other
   void swap(Map &other) {
     std::swap(root, other.root);
     std::swap(size_, other.size_);
+    pool.swap(other.pool);
   };
 
   // Возвращает итератор на первый элемент который не меньше чем переданный
-  // ключ. [O(h)]
-  Iterator lower_bound(const Key &key) {
-    Node *tmp = search(key, root);
-    if (tmp) {
-      Iterator it(tmp);
-      return it;
-    } else {
-      Node *ntmp = FindPossibleParent(key, root);
-      if (ntmp->pair.first > key) {
-        Iterator it(ntmp);
-        return it;
-      } else if (ntmp->pair.first < key && ntmp->right) {
-        Iterator it(ntmp);
-        ++it;
-        return it;
-      }
+  // ключ, или end(), если все ключи меньше. [O(h)]
+  Iterator lower_bound(const Key &key) { return Iterator(bound(key, false), this); }
+
+  // Итератор на первый элемент строго больше key или end() [O(h)]
+  Iterator upper_bound(const Key &key) { return Iterator(bound(key, true), this); }
+
+  // Все элементы с ключом key: [lower_bound, upper_bound)
+  std::pair<Iterator, Iterator> equal_range(const Key &key) {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  // Удаляет элементы [first, last) и возвращает last. Узлы вынимаются по
+  // одному без поиска, а перебалансировка после удаления в среднем O(1),
+  // так что всего O(log n + k) (с OrderStatistics - O(k log n) из-за
+  // пересчета размеров). Итераторы на остальные элементы не портятся.
+  //  map.erase(map.begin(), map.lower_bound(cutoff)); // все ключи < cutoff
+  Iterator erase(Iterator first, Iterator last) {
+    if (first == begin() && last == end()) {
+      clear();
+      return end();
     }
-    throw std::out_of_range("Your key is larger than largest in Map!!!");
-  };
+    Node *node = first.node;
+    while (node != last.node) {
+      Node *next = successor(node);
+      erase_node(node);
+      node = next;
+    }
+    return last;
+  }
+
+  // Вызывает fn(pair) для каждого элемента с ключом из [lo, hi) по
+  // возрастанию, ходя прямо по узлам [O(log n + k)]
+  template <class Fn> void for_each_in_range(const Key &lo, const Key &hi, Fn fn) {
+    for (Node *node = bound(lo, false); node && node->pair.first < hi;
+         node = successor(node)) {
+      fn(node->pair);
+    }
+  }
 
   // Очищает контейнер [O(n)]
   // Map<int, std::string> c =
@@ -412,111 +991,702 @@ public:
   //   };
   // c.clear;
   // c.size() == 0 //true;
+  // Если у узлов тривиальный деструктор (Map<int, int> и т.п.), то дерево
+  // даже не обходится: пул просто отдает все свои блоки [O(число блоков)]
+  void clear() {
+    if constexpr (!std::is_trivially_destructible<Node>::value) {
+      clearup(root);
+    }
+    pool.release();
+    root = nullptr; // Если этого не сделать, то в root будет мусор
+    size_ = 0;
+  };
+
+
+  class Iterator {
+    friend Map;
+
+  private:
+    Node *node;
+    Map *map; // нужен только для --end(); его передает каждый метод Map
+
+  public:
+    // Заполнить:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type *;
+    using reference = value_type &;
+
+    Iterator(Node *tmp, Map *map_) : node(tmp), map(map_) {}
+
+    // Инкремент. Движение к следующему элементу. Ключи не сравниваются:
+    // при подъеме смотрим, из какого поддерева родителя пришли, так что
+    // полный обход - ровно O(n) переходов по указателям.
+    Iterator &operator++() {
+      node = successor(node);
+      return *this;
+    };
+
+    // Декремент. Движение к предыдущему элементу. --end() дает последний
+    Iterator &operator--() {
+      node = node ? predecessor(node) : rightmost(map->root);
+      return *this;
+    };
+
+    // Проверка на неравенство двух итераторов.
+    bool operator!=(const Iterator &other) { return node != other.node; };
+
+    bool operator==(const Iterator &other) { return node == other.node; }
+
+    // разыменование (как с указателями): *it = 42; или std::cout << *it;
+    // (Это так не работает).
+    //
+    // В начальном условие возврощает std::pair<const Key, Value>, но
+    // в этом случае прийдется переписовать весь код где заменяем pair
+    // в node-ах, потому как pair у каждого node будет закрыт
+    //
+    // P.S. Коля я перепесал тесты чтобы без const работали
+    std::pair<Key, Value> &operator*() { return node->pair; }
+
+    std::pair<Key, Value> *operator->() { return &node->pair; }
+  };
+  class ConstIterator {
+    friend Map;
+
+  private:
+    Iterator it;
+
+  public:
+    // Заполнить
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type *;
+    using reference = value_type &;
+
+    ConstIterator(Iterator iter) : it(iter) {}
+
+    ConstIterator &operator++() {
+      ++it;
+      return *this;
+    };
+
+    ConstIterator &operator--() {
+      --it;
+      return *this;
+    };
+
+    bool operator!=(const ConstIterator &other) { return it != other.it; };
+
+    bool operator==(const ConstIterator &other) { return it == other.it; };
+
+    // единственное отличие от Iterator, что возвращает константную ссылку
+    const std::pair<Key, Value> &operator*() { return *it; };
+
+    const std::pair<Key, Value> *operator->() { return &(*it); }
+  };
+};
+
+// BTreeMap - упорядоченный словарь с тем же интерфейсом, что и Map, но
+// устроенный как B+-дерево. Во внутренних узлах лежат только ключи-разделители
+// и указатели на детей, а все пары - в листьях, подряд в одном массиве. Листья
+// связаны в двусвязный список, поэтому обход по порядку идет по непрерывной
+// памяти. Узлы выровнены по кэш-линии и занимают несколько линий: на уровень
+// приходится пара промахов кэша, а уровней в разы меньше, чем у Map. Указатели
+// хранятся на узел, а не на каждую пару, так что памяти на элемент тоже уходит
+// меньше.
+template <class Key, class Value> class BTreeMap {
+public:
+  class Iterator;
+  class ConstIterator;
+
+private:
+  static constexpr std::size_t kCacheLine = 64;
+  // Ключей во внутреннем узле - на 4 кэш-линии, пар в листе - на 8, но не
+  // меньше 4, чтобы узел можно было делить пополам
+  static constexpr int kInnerSlots =
+      std::max<int>(4, 4 * kCacheLine / sizeof(Key));
+  static constexpr int kLeafSlots =
+      std::max<int>(4, 8 * kCacheLine / sizeof(std::pair<Key, Value>));
+  // Узел кроме корня и правого края не бывает заполнен меньше чем
+  // наполовину, поэтому 64 уровней хватит всегда
+  static constexpr int kMaxHeight = 64;
+
+  struct Node {
+    bool leaf;
+    int count = 0; // число пар в листе или ключей во внутреннем узле
+
+    explicit Node(bool leaf_) : leaf(leaf_) {}
+  };
+
+  struct alignas(kCacheLine) Leaf : Node {
+    Leaf *prev = nullptr;
+    Leaf *next = nullptr;
+    std::pair<Key, Value> slots[kLeafSlots];
+
+    Leaf() : Node(true) {}
+  };
+
+  // У внутреннего узла count ключей и count + 1 детей. В children[i] все
+  // ключи меньше keys[i], в children[i + 1] - не меньше
+  struct alignas(kCacheLine) Inner : Node {
+    Key keys[kInnerSlots];
+    Node *children[kInnerSlots + 1];
+
+    Inner() : Node(false) {}
+  };
+
+  // Шаг пути от корня: узел и номер ребенка, в которого спустились
+  struct PathEntry {
+    Inner *node;
+    int index;
+  };
+
+  Node *root = nullptr;
+  Leaf *head = nullptr; // самый левый лист, begin() за O(1)
+  Leaf *tail = nullptr; // самый правый лист, нужен для --end()
+
+  std::size_t size_ = 0;
+
+  // Спускается от корня к листу, в котором должен лежать key. Если path не
+  // nullptr, то записывает в него пройденные внутренние узлы
+  Leaf *descend(const Key &key, PathEntry *path, int &depth) const {
+    depth = 0;
+    Node *node = root;
+    while (!node->leaf) {
+      Inner *inner = static_cast<Inner *>(node);
+      int i = std::upper_bound(inner->keys, inner->keys + inner->count, key) -
+              inner->keys;
+      if (path) {
+        path[depth] = {inner, i};
+      }
+      ++depth;
+      node = inner->children[i];
+    }
+    return static_cast<Leaf *>(node);
+  }
+
+  // Позиция первой пары в листе, ключ которой не меньше key
+  static int leaf_position(const Leaf *leaf, const Key &key) {
+    return std::lower_bound(leaf->slots, leaf->slots + leaf->count, key,
+                            [](const std::pair<Key, Value> &pair,
+                               const Key &k) { return pair.first < k; }) -
+           leaf->slots;
+  }
+
+  // Лист и позиция пары с ключом key, или nullptr
+  Leaf *search(const Key &key, int &pos) const {
+    if (!root) {
+      return nullptr;
+    }
+    int depth;
+    Leaf *leaf = descend(key, nullptr, depth);
+    pos = leaf_position(leaf, key);
+    if (pos < leaf->count && leaf->slots[pos].first == key) {
+      return leaf;
+    }
+    return nullptr;
+  }
+
+  // Вставляет пару в лист со свободным местом на позицию pos
+  template <class K> static void insert_into_leaf(Leaf *leaf, int pos, K &&key) {
+    std::move_backward(leaf->slots + pos, leaf->slots + leaf->count,
+                       leaf->slots + leaf->count + 1);
+    leaf->slots[pos] = std::pair<Key, Value>(std::forward<K>(key), Value());
+    ++leaf->count;
+  }
+
+  // Вешает right справа от ребенка path[depth - 1] с разделителем separator.
+  // Переполненные внутренние узлы делятся пополам, средний ключ уходит
+  // выше; если поделился корень, то дерево растет на уровень. При
+  // дописывании в конец (rightmost) левый узел остается полным, иначе
+  // вставка по возрастанию оставляла бы все узлы заполненными наполовину
+  void insert_into_parent(PathEntry *path, int depth, Key separator,
+                          Node *right, bool rightmost) {
+    while (depth > 0) {
+      --depth;
+      Inner *parent = path[depth].node;
+      int i = path[depth].index;
+      if (parent->count < kInnerSlots) {
+        std::move_backward(parent->keys + i, parent->keys + parent->count,
+                           parent->keys + parent->count + 1);
+        std::copy_backward(parent->children + i + 1,
+                           parent->children + parent->count + 1,
+                           parent->children + parent->count + 2);
+        parent->keys[i] = std::move(separator);
+        parent->children[i + 1] = right;
+        ++parent->count;
+        return;
+      }
+
+      // Собираем kInnerSlots + 1 ключей во временный массив и делим
+      Key keys[kInnerSlots + 1];
+      Node *children[kInnerSlots + 2];
+      std::move(parent->keys, parent->keys + i, keys);
+      keys[i] = std::move(separator);
+      std::move(parent->keys + i, parent->keys + kInnerSlots, keys + i + 1);
+      std::copy(parent->children, parent->children + i + 1, children);
+      children[i + 1] = right;
+      std::copy(parent->children + i + 1, parent->children + kInnerSlots + 1,
+                children + i + 2);
+
+      int mid = rightmost ? kInnerSlots - 1 : (kInnerSlots + 1) / 2;
+      Inner *sibling = new Inner;
+      std::move(keys, keys + mid, parent->keys);
+      std::copy(children, children + mid + 1, parent->children);
+      parent->count = mid;
+      std::move(keys + mid + 1, keys + kInnerSlots + 1, sibling->keys);
+      std::copy(children + mid + 1, children + kInnerSlots + 2,
+                sibling->children);
+      sibling->count = kInnerSlots - mid;
+
+      separator = std::move(keys[mid]);
+      right = sibling;
+    }
+
+    Inner *new_root = new Inner;
+    new_root->keys[0] = std::move(separator);
+    new_root->children[0] = root;
+    new_root->children[1] = right;
+    new_root->count = 1;
+    root = new_root;
+  }
+
+  // Находит пару с ключом key или вставляет новую со значением Value()
+  template <class K> std::pair<Leaf *, int> find_or_insert(K &&key) {
+    if (!root) {
+      root = head = tail = new Leaf;
+    }
+    PathEntry path[kMaxHeight];
+    int depth;
+    Leaf *leaf = descend(key, path, depth);
+    int pos = leaf_position(leaf, key);
+    if (pos < leaf->count && leaf->slots[pos].first == key) {
+      return {leaf, pos};
+    }
+    ++size_;
+    if (leaf->count < kLeafSlots) {
+      insert_into_leaf(leaf, pos, std::forward<K>(key));
+      return {leaf, pos};
+    }
+
+    // Лист полон: правая половина переезжает в новый лист. Если пишем в
+    // конец последнего листа, то новый лист начинается с одной новой пары
+    bool rightmost = pos == kLeafSlots && !leaf->next;
+    int half = rightmost ? kLeafSlots : kLeafSlots / 2;
+    Leaf *right = new Leaf;
+    std::move(leaf->slots + half, leaf->slots + kLeafSlots, right->slots);
+    right->count = kLeafSlots - half;
+    leaf->count = half;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) {
+      leaf->next->prev = right;
+    } else {
+      tail = right;
+    }
+    leaf->next = right;
+
+    std::pair<Leaf *, int> result;
+    if (pos < half) {
+      insert_into_leaf(leaf, pos, std::forward<K>(key));
+      result = {leaf, pos};
+    } else {
+      insert_into_leaf(right, pos - half, std::forward<K>(key));
+      result = {right, pos - half};
+    }
+    insert_into_parent(path, depth, right->slots[0].first, right, rightmost);
+    return result;
+  }
+
+  // Переносит все пары из right в left и удаляет right
+  void merge_leaves(Leaf *left, Leaf *right) {
+    std::move(right->slots, right->slots + right->count,
+              left->slots + left->count);
+    left->count += right->count;
+    left->next = right->next;
+    if (right->next) {
+      right->next->prev = left;
+    } else {
+      tail = left;
+    }
+    delete right;
+  }
+
+  // Удаляет из внутреннего узла ключ keys[i] и ребенка children[i + 1]
+  static void remove_from_inner(Inner *node, int i) {
+    std::move(node->keys + i + 1, node->keys + node->count, node->keys + i);
+    std::copy(node->children + i + 2, node->children + node->count + 1,
+              node->children + i + 1);
+    --node->count;
+  }
+
+  // Чинит внутренний узел path[level] после удаления из него ключа: занимает
+  // ключ у соседа через родителя или сливается с соседом
+  void rebalance_inner(PathEntry *path, int level) {
+    Inner *node = path[level].node;
+    if (level == 0) {
+      if (node->count == 0) {
+        root = node->children[0];
+        delete node;
+      }
+      return;
+    }
+    if (node->count >= kInnerSlots / 2) {
+      return;
+    }
+    Inner *parent = path[level - 1].node;
+    int i = path[level - 1].index;
+    Inner *left = i > 0 ? static_cast<Inner *>(parent->children[i - 1]) : nullptr;
+    Inner *right =
+        i < parent->count ? static_cast<Inner *>(parent->children[i + 1]) : nullptr;
+
+    if (left && left->count > kInnerSlots / 2) {
+      std::move_backward(node->keys, node->keys + node->count,
+                         node->keys + node->count + 1);
+      std::copy_backward(node->children, node->children + node->count + 1,
+                         node->children + node->count + 2);
+      node->keys[0] = std::move(parent->keys[i - 1]);
+      node->children[0] = left->children[left->count];
+      parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+      --left->count;
+      ++node->count;
+      return;
+    }
+    if (right && right->count > kInnerSlots / 2) {
+      node->keys[node->count] = std::move(parent->keys[i]);
+      node->children[node->count + 1] = right->children[0];
+      ++node->count;
+      parent->keys[i] = std::move(right->keys[0]);
+      std::move(right->keys + 1, right->keys + right->count, right->keys);
+      std::copy(right->children + 1, right->children + right->count + 1,
+                right->children);
+      --right->count;
+      return;
+    }
+
+    // Соседи заполнены ровно наполовину - сливаемся с одним из них, ключ
+    // родителя между ними спускается в середину
+    if (!left) {
+      left = node;
+      node = right;
+      ++i;
+    }
+    left->keys[left->count] = std::move(parent->keys[i - 1]);
+    std::move(node->keys, node->keys + node->count, left->keys + left->count + 1);
+    std::copy(node->children, node->children + node->count + 1,
+              left->children + left->count + 1);
+    left->count += node->count + 1;
+    delete node;
+    remove_from_inner(parent, i - 1);
+    rebalance_inner(path, level - 1);
+  }
+
+  // То же для листа path[depth], из которого только что удалили пару
+  void rebalance_leaf(Leaf *leaf, PathEntry *path, int depth) {
+    if (depth == 0) {
+      if (leaf->count == 0) {
+        delete leaf;
+        root = head = tail = nullptr;
+      }
+      return;
+    }
+    if (leaf->count >= kLeafSlots / 2) {
+      return;
+    }
+    Inner *parent = path[depth - 1].node;
+    int i = path[depth - 1].index;
+    Leaf *left = i > 0 ? static_cast<Leaf *>(parent->children[i - 1]) : nullptr;
+    Leaf *right =
+        i < parent->count ? static_cast<Leaf *>(parent->children[i + 1]) : nullptr;
+
+    if (left && left->count > kLeafSlots / 2) {
+      std::move_backward(leaf->slots, leaf->slots + leaf->count,
+                         leaf->slots + leaf->count + 1);
+      leaf->slots[0] = std::move(left->slots[left->count - 1]);
+      left->slots[--left->count] = std::pair<Key, Value>();
+      ++leaf->count;
+      parent->keys[i - 1] = leaf->slots[0].first;
+      return;
+    }
+    if (right && right->count > kLeafSlots / 2) {
+      leaf->slots[leaf->count++] = std::move(right->slots[0]);
+      std::move(right->slots + 1, right->slots + right->count, right->slots);
+      right->slots[--right->count] = std::pair<Key, Value>();
+      parent->keys[i] = right->slots[0].first;
+      return;
+    }
+
+    if (left) {
+      merge_leaves(left, leaf);
+      remove_from_inner(parent, i - 1);
+    } else {
+      merge_leaves(leaf, right);
+      remove_from_inner(parent, i);
+    }
+    rebalance_inner(path, depth - 1);
+  }
+
+  // Глубокая копия поддерева; листья по порядку сцепляются через last
+  Node *clone(const Node *node, Leaf *&last) {
+    if (node->leaf) {
+      Leaf *copy = new Leaf(*static_cast<const Leaf *>(node));
+      copy->prev = last;
+      copy->next = nullptr;
+      if (last) {
+        last->next = copy;
+      } else {
+        head = copy;
+      }
+      last = copy;
+      return copy;
+    }
+    const Inner *inner = static_cast<const Inner *>(node);
+    Inner *copy = new Inner;
+    std::copy(inner->keys, inner->keys + inner->count, copy->keys);
+    for (int i = 0; i <= inner->count; ++i) {
+      copy->children[i] = clone(inner->children[i], last);
+    }
+    copy->count = inner->count;
+    return copy;
+  }
+
+  // Высота B-дерева не больше нескольких десятков, рекурсия безопасна
+  static void destroy(Node *node) {
+    if (!node->leaf) {
+      Inner *inner = static_cast<Inner *>(node);
+      for (int i = 0; i <= inner->count; ++i) {
+        destroy(inner->children[i]);
+      }
+      delete inner;
+    } else {
+      delete static_cast<Leaf *>(node);
+    }
+  }
+
+public:
+  // Создает пустой словарь
+  BTreeMap() = default;
+
+  // Конструктор для initializer_list
+  BTreeMap(std::initializer_list<std::pair<Key, Value>> other) {
+    for (auto &value : other) {
+      (*this)[value.first] = value.second;
+    }
+  }
+
+  // Глубокая копия other [O(n)]
+  BTreeMap(const BTreeMap &other) {
+    if (other.root) {
+      Leaf *last = nullptr;
+      root = clone(other.root, last);
+      tail = last;
+      size_ = other.size_;
+    }
+  }
+
+  BTreeMap(BTreeMap &&other) { swap(other); }
+
+  BTreeMap &operator=(const BTreeMap &other) {
+    BTreeMap tmp{other};
+    swap(tmp);
+    return *this;
+  }
+
+  BTreeMap &operator=(BTreeMap &&other) {
+    BTreeMap tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  ~BTreeMap() { clear(); }
+
+  Iterator begin() { return Iterator(head, 0, this); }
+
+  ConstIterator begin() const { return const_cast<BTreeMap *>(this)->begin(); }
+
+  Iterator end() { return Iterator(nullptr, 0, this); }
+
+  ConstIterator end() const { return const_cast<BTreeMap *>(this)->end(); }
+
+  std::size_t size() const { return size_; }
+
+  // Число уровней, включая уровень листьев
+  std::size_t height() const {
+    std::size_t result = 0;
+    for (const Node *node = root; node; ++result) {
+      node = node->leaf ? nullptr : static_cast<const Inner *>(node)->children[0];
+    }
+    return result;
+  }
+
+  bool contains(const Key &key) const {
+    int pos;
+    return search(key, pos) != nullptr;
+  }
+
+  Iterator find(const Key &key) {
+    int pos;
+    Leaf *leaf = search(key, pos);
+    return leaf ? Iterator(leaf, pos, this) : end();
+  }
+
+  // Бросает std::out_of_range, если ключа нет
+  const Value &operator[](const Key &key) const {
+    int pos;
+    Leaf *leaf = search(key, pos);
+    if (leaf) {
+      return leaf->slots[pos].second;
+    }
+    throw std::out_of_range("Error!!! Key is out of range!!!");
+  }
+
+  // Если ключа нет, то создает элемент со значением Value()
+  Value &operator[](const Key &key) {
+    auto [leaf, pos] = find_or_insert(key);
+    return leaf->slots[pos].second;
+  }
+
+  Value &operator[](Key &&key) {
+    auto [leaf, pos] = find_or_insert(std::move(key));
+    return leaf->slots[pos].second;
+  }
+
+  // Удаляет элемент по ключу, false если его не было
+  bool erase(const Key &key) {
+    if (!root) {
+      return false;
+    }
+    PathEntry path[kMaxHeight];
+    int depth;
+    Leaf *leaf = descend(key, path, depth);
+    int pos = leaf_position(leaf, key);
+    if (pos == leaf->count || !(leaf->slots[pos].first == key)) {
+      return false;
+    }
+    std::move(leaf->slots + pos + 1, leaf->slots + leaf->count,
+              leaf->slots + pos);
+    // освобождаем ресурсы удаленной пары сразу, а не при перезаписи слота
+    leaf->slots[--leaf->count] = std::pair<Key, Value>();
+    --size_;
+    rebalance_leaf(leaf, path, depth);
+    return true;
+  }
+
+  void swap(BTreeMap &other) {
+    std::swap(root, other.root);
+    std::swap(head, other.head);
+    std::swap(tail, other.tail);
+    std::swap(size_, other.size_);
+  }
+
+  // Итератор на первый элемент не меньше key или end(), если такого нет
+  // [O(log n)]
+  Iterator lower_bound(const Key &key) {
+    if (!root) {
+      return end();
+    }
+    int depth;
+    Leaf *leaf = descend(key, nullptr, depth);
+    int pos = leaf_position(leaf, key);
+    if (pos == leaf->count) {
+      return Iterator(leaf->next, 0, this);
+    }
+    return Iterator(leaf, pos, this);
+  }
+
   void clear() {
-    clearup(root);
-    root = nullptr; // Если этого не сделать, то в root будет мусор
+    if (root) {
+      destroy(root);
+    }
+    root = head = tail = nullptr;
     size_ = 0;
-  };
-
+  }
 
+  // Итератор - лист и номер пары в нем; end() - (nullptr, 0)
   class Iterator {
-    friend Map;
+    friend BTreeMap;
 
   private:
-    Node *node;
+    Leaf *leaf;
+    int index;
+    BTreeMap *map;
 
   public:
-    // Заполнить:
     using iterator_category = std::bidirectional_iterator_tag;
-    using value_type = Key;
+    using value_type = std::pair<Key, Value>;
     using difference_type = std::ptrdiff_t;
     using pointer = value_type *;
     using reference = value_type &;
 
-    Iterator(Node *tmp) : node(tmp) {}
-    // Инкремент. Движение к следующему элементу.
+    Iterator(Leaf *leaf_, int index_, BTreeMap *map_)
+        : leaf(leaf_), index(index_), map(map_) {}
+
     Iterator &operator++() {
-      if (node->right) {
-        node = node->right;
-        while (node && node->left) {
-          node = node->left;
-        }
-      } else {
-        while (node->parent && node->parent->pair.first < node->pair.first) {
-          node = node->parent;
-        }
-        node = node->parent;
+      if (++index == leaf->count) {
+        leaf = leaf->next;
+        index = 0;
       }
       return *this;
-    };
+    }
 
-    // Декремент. Движение к предыдущему элементу.
     Iterator &operator--() {
-      if (node->left) {
-        node = node->left;
-        while (node && node->right) {
-          node = node->right;
-        }
+      if (!leaf) {
+        leaf = map->tail;
+        index = leaf->count - 1;
+      } else if (index == 0) {
+        leaf = leaf->prev;
+        index = leaf->count - 1;
       } else {
-        while (node->parent && node->parent->pair.first > node->pair.first) {
-          node = node->parent;
-        }
-        node = node->parent;
+        --index;
       }
       return *this;
-    };
+    }
 
-    // Проверка на неравенство двух итераторов.
-    bool operator!=(const Iterator &other) { return node != other.node; };
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
 
-    bool operator==(const Iterator &other) { return node == other.node; }
+    bool operator==(const Iterator &other) const {
+      return leaf == other.leaf && index == other.index;
+    }
 
-    // разыменование (как с указателями): *it = 42; или std::cout << *it;
-    // (Это так не работает).
-    //
-    // В начальном условие возврощает std::pair<const Key, Value>, но
-    // в этом случае прийдется переписовать весь код где заменяем pair
-    // в node-ах, потому как pair у каждого node будет закрыт
-    //
-    // P.S. Коля я перепесал тесты чтобы без const работали
-    std::pair<Key, Value> &operator*() { return node->pair; }
+    std::pair<Key, Value> &operator*() const { return leaf->slots[index]; }
 
-    std::pair<Key, Value> *operator->() { return &node->pair; }
+    std::pair<Key, Value> *operator->() const { return &leaf->slots[index]; }
   };
+
   class ConstIterator {
-    friend Map;
+    friend BTreeMap;
 
   private:
     Iterator it;
 
   public:
-    // Заполнить
     using iterator_category = std::bidirectional_iterator_tag;
-    using value_type = Key;
+    using value_type = std::pair<Key, Value>;
     using difference_type = std::ptrdiff_t;
-    using pointer = value_type *;
-    using reference = value_type &;
+    using pointer = const value_type *;
+    using reference = const value_type &;
 
     ConstIterator(Iterator iter) : it(iter) {}
 
     ConstIterator &operator++() {
       ++it;
       return *this;
-    };
+    }
 
     ConstIterator &operator--() {
       --it;
       return *this;
-    };
+    }
 
-    bool operator!=(const ConstIterator &other) { return it != other.it; };
+    bool operator!=(const ConstIterator &other) const { return it != other.it; }
 
-    bool operator==(const ConstIterator &other) { return it == other.it; };
+    bool operator==(const ConstIterator &other) const { return it == other.it; }
 
-    // единственное отличие от Iterator, что возвращает константную ссылку
-    const std::pair<Key, Value> &operator*() { return *it; };
+    const std::pair<Key, Value> &operator*() const { return *it; }
 
-    const std::pair<Key, Value> *operator->() { return &(*it); }
+    const std::pair<Key, Value> *operator->() const { return &(*it); }
   };
 };
 
@@ -683,7 +1853,770 @@ void test_lower_bound_equal() {
   assert(*map.lower_bound("c") == expected);
 }
 
-int main() {
+void test_lower_bound_past_end() {
+  Map<int, int> map;
+  assert(map.lower_bound(1) == map.end());
+  for (int i = 0; i < 100; i += 10) {
+    map[i] = i;
+  }
+  assert(map.lower_bound(91) == map.end());
+  // ключ между листом без правого ребенка и его предком
+  for (int i = 1; i < 90; i += 10) {
+    assert(map.lower_bound(i)->first == i + 9);
+  }
+}
+
+void test_upper_bound_and_equal_range() {
+  Map<int, int> map;
+  for (int i = 0; i < 100; i += 10) {
+    map[i] = i;
+  }
+  assert(map.upper_bound(10)->first == 20);
+  assert(map.upper_bound(15)->first == 20);
+  assert(map.upper_bound(90) == map.end());
+  assert(map.upper_bound(-5)->first == 0);
+
+  auto [from, to] = map.equal_range(30);
+  assert(from->first == 30 && to->first == 40);
+  auto [empty_from, empty_to] = map.equal_range(35);
+  assert(empty_from == empty_to && empty_from->first == 40);
+
+  // наибольший ключ <= k: std::prev(upper_bound(k)), в том числе когда
+  // upper_bound - это конец
+  for (int k = 0; k < 200; ++k) {
+    int floor = std::min(k / 10 * 10, 90);
+    assert(std::prev(map.upper_bound(k))->first == floor);
+  }
+  // диапазон до конца: последний элемент через --second
+  auto [last_from, last_to] = map.equal_range(90);
+  assert(last_to == map.end());
+  --last_to;
+  assert(last_to == last_from && last_to->first == 90);
+  // обход диапазона [20, 60] с конца
+  std::string keys;
+  for (auto it = map.upper_bound(60); it != map.lower_bound(20);) {
+    --it;
+    keys += std::to_string(it->first) + " ";
+  }
+  assert(keys == "60 50 40 30 20 ");
+  // наибольший ключ < k: std::prev(lower_bound(k))
+  assert(std::prev(map.lower_bound(1000))->first == 90);
+  assert(std::prev(map.lower_bound(40))->first == 30);
+}
+
+void test_erase_range() {
+  Map<int, int> map;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = i;
+  }
+  auto kept = map.find(700);
+  auto last = map.erase(map.lower_bound(100), map.lower_bound(600));
+  assert(last->first == 600);
+  assert(map.size() == 500 && map.is_red_black());
+  assert(!map.contains(100) && !map.contains(599));
+  assert(map.contains(99) && map.contains(600));
+  assert(kept->first == 700);
+
+  map.erase(map.begin(), map.upper_bound(650));
+  assert(map.begin()->first == 651 && map.size() == 349);
+  map.erase(map.lower_bound(900), map.end());
+  assert(map.size() == 249 && map.is_red_black());
+  assert(map.erase(map.begin(), map.begin()) == map.begin());
+  map.erase(map.begin(), map.end());
+  assert(map.size() == 0 && map.begin() == map.end());
+}
+
+void test_for_each_in_range() {
+  Map<std::string, int> map{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}};
+  std::string keys;
+  int sum = 0;
+  map.for_each_in_range("b", "e", [&](std::pair<std::string, int> &pair) {
+    keys += pair.first;
+    sum += pair.second;
+    pair.second = 0;
+  });
+  assert(keys == "bcd" && sum == 9);
+  assert(map["c"] == 0 && map["e"] == 5);
+
+  int calls = 0;
+  map.for_each_in_range("x", "z", [&](std::pair<std::string, int> &) { ++calls; });
+  map.for_each_in_range("c", "c", [&](std::pair<std::string, int> &) { ++calls; });
+  assert(calls == 0);
+}
+
+// Конец, полученный из любого метода, а не только из end(), можно
+// уменьшить и попасть на последний элемент
+void test_decrement_end_iterators() {
+  Map<int, int> map;
+  for (int i = 0; i < 100; i += 10) {
+    map[i] = i;
+  }
+  auto missing = map.find(55);
+  assert(missing == map.end());
+  assert((--missing)->first == 90);
+  auto past = map.upper_bound(90);
+  assert(past == map.end() && (--past)->first == 90);
+  auto after_last = map.lower_bound(91);
+  assert((--after_last)->first == 90);
+  auto it = map.lower_bound(1000);
+  --it;
+  --it;
+  assert(it->first == 80);
+
+  const Map<int, int> &view = map;
+  auto last = view.end();
+  assert((--last)->first == 90);
+}
+
+void test_transparent_lookup() {
+  Map<std::string, int> map;
+  map["b"] = 2;
+  map["a"] = 1;
+  map["c"] = 3;
+  std::string_view view = "c";
+
+  assert(map.contains(view));
+  assert(!map.contains(std::string_view{"d"}));
+  assert(map.find(view)->second == 3);
+  assert(map.find("a")->second == 1);
+  assert(map.find("d") == map.end());
+  assert(map.erase(std::string_view{"b"}));
+  assert(!map.contains("b"));
+  assert(map.size() == 2);
+}
+
+// Значение, которое считает свои копирования
+struct CopyCounter {
+  static inline int copies = 0;
+  std::vector<int> payload;
+
+  CopyCounter() = default;
+  CopyCounter(int size, int value) : payload(size, value) {}
+  CopyCounter(const CopyCounter &other) : payload(other.payload) { ++copies; }
+  CopyCounter(CopyCounter &&other) = default;
+  CopyCounter &operator=(const CopyCounter &other) {
+    payload = other.payload;
+    ++copies;
+    return *this;
+  }
+  CopyCounter &operator=(CopyCounter &&other) = default;
+};
+
+void test_emplace() {
+  CopyCounter::copies = 0;
+  Map<std::string, CopyCounter> map;
+
+  auto [it, inserted] = map.try_emplace("b", 1000, 7);
+  assert(inserted && it->second.payload.size() == 1000);
+  assert(!map.try_emplace("b", 1, 1).second);
+  assert(map["b"].payload.size() == 1000);
+
+  assert(map.emplace(std::piecewise_construct, std::forward_as_tuple("a"),
+                     std::forward_as_tuple(10, 2)).second);
+  assert(!map.emplace("a", CopyCounter(5, 5)).second);
+  assert(map["a"].payload.size() == 10);
+
+  assert(map.insert_or_assign("c", CopyCounter(3, 3)).second);
+  assert(!map.insert_or_assign("c", CopyCounter(4, 4)).second);
+  assert(map["c"].payload.size() == 4);
+
+  assert(map.size() == 3);
+  assert(CopyCounter::copies == 0);
+}
+
+// Высота красно-черного дерева из n узлов не больше 2*log2(n + 1)
+bool is_balanced(const Map<int, int> &map) {
+  return map.height() <= 2 * std::log2(map.size() + 1);
+}
+
+void test_balanced_sorted_insert() {
+  Map<int, int> map;
+  for (int i = 0; i < 10000; ++i) {
+    map[i] = i;
+  }
+  assert(is_balanced(map));
+
+  Map<int, int> reversed;
+  for (int i = 10000; i > 0; --i) {
+    reversed[i] = i;
+  }
+  assert(is_balanced(reversed));
+}
+
+void test_erase_keeps_order_and_balance() {
+  std::mt19937 gen(42);
+  std::vector<int> keys(2000);
+  for (int i = 0; i < 2000; ++i) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), gen);
+
+  Map<int, int> map;
+  for (int key : keys) {
+    map[key] = key * 10;
+  }
+  std::shuffle(keys.begin(), keys.end(), gen);
+  std::vector<bool> erased(2000, false);
+  for (int i = 0; i < 1500; ++i) {
+    assert(map.erase(keys[i]));
+    erased[keys[i]] = true;
+  }
+  assert(!map.erase(keys[0]));
+  assert(map.size() == 500);
+  assert(is_balanced(map));
+
+  int previous = -1;
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    assert(it->first > previous && !erased[it->first]);
+    assert(it->second == it->first * 10);
+    previous = it->first;
+    ++count;
+  }
+  assert(count == 500);
+
+  for (int i = 1500; i < 2000; ++i) {
+    assert(map.erase(keys[i]));
+  }
+  assert(map.size() == 0);
+  assert(map.begin() == map.end());
+}
+
+void test_copy_and_clear_large_tree() {
+  Map<int, int> map;
+  for (int i = 0; i < 200000; ++i) {
+    map[i] = -i;
+  }
+  Map<int, int> copied{map};
+  assert(copied.size() == map.size() && copied.height() == map.height());
+  assert(is_balanced(copied));
+  int expected = 0;
+  for (auto it = copied.begin(); it != copied.end(); ++it, ++expected) {
+    assert(it->first == expected && it->second == -expected);
+  }
+  assert(expected == 200000);
+  map.clear();
+  assert(map.size() == 0 && map.begin() == map.end());
+  assert(copied.contains(199999) && !map.contains(199999));
+}
+
+void test_assign_sorted() {
+  for (int n = 0; n <= 130; ++n) {
+    std::vector<std::pair<int, int>> rows;
+    for (int i = 0; i < n; ++i) {
+      rows.push_back({2 * i, i});
+    }
+    Map<int, int> map(sorted_unique, rows.begin(), rows.end());
+    assert(map.size() == static_cast<std::size_t>(n));
+    assert(map.is_red_black() && is_balanced(map));
+    int expected = 0;
+    for (auto it = map.begin(); it != map.end(); ++it, ++expected) {
+      assert(it->first == 2 * expected && it->second == expected);
+    }
+    assert(expected == n);
+
+    // Цвета корректны, значит обычные вставки и удаления продолжают работать
+    for (int i = 0; i < n; ++i) {
+      map[2 * i + 1] = i;
+    }
+    for (int i = 0; i < n; i += 2) {
+      assert(map.erase(2 * i));
+    }
+    assert(map.is_red_black());
+  }
+
+  Map<std::string, int> list{{"a", 1}, {"b", 2}, {"c", 3}};
+  assert(list.is_red_black() && list.size() == 3 && list["b"] == 2);
+  Map<std::string, int> unsorted{{"c", 3}, {"a", 1}, {"c", 4}};
+  assert(unsorted.size() == 2 && unsorted["c"] == 4);
+}
+
+void test_assign_sorted_parallel() {
+  std::vector<std::pair<int, int>> rows;
+  for (int i = 0; i < 300000; ++i) {
+    rows.push_back({i, -i});
+  }
+  Map<int, int> map{{5, 5}};
+  map.assign_sorted_parallel(rows.begin(), rows.end(), 4);
+  assert(map.size() == rows.size() && map.is_red_black());
+  int expected = 0;
+  for (auto it = map.begin(); it != map.end(); ++it, ++expected) {
+    assert(it->first == expected && it->second == -expected);
+  }
+  assert(expected == 300000);
+}
+
+void test_order_statistics() {
+  std::mt19937 gen(3);
+  Map<int, int, true> map;
+  std::vector<int> present(3000, 0);
+  for (int step = 0; step < 12000; ++step) {
+    int key = gen() % 3000;
+    if (gen() % 3) {
+      map[key] = key;
+      present[key] = 1;
+    } else {
+      map.erase(key);
+      present[key] = 0;
+    }
+  }
+  assert(map.is_red_black());
+
+  std::vector<int> sorted;
+  for (int key = 0; key < 3000; ++key) {
+    if (present[key]) {
+      sorted.push_back(key);
+    }
+  }
+  assert(map.size() == sorted.size());
+  for (std::size_t k = 0; k < sorted.size(); ++k) {
+    assert(map.select(k)->first == sorted[k]);
+    assert(map.rank(sorted[k]) == k);
+    assert(map.index_of(map.find(sorted[k])) == k);
+  }
+  assert(map.select(sorted.size()) == map.end());
+  assert(map.rank(-1) == 0 && map.rank(5000) == sorted.size());
+  assert(map.distance(map.begin(), map.end()) ==
+         static_cast<std::ptrdiff_t>(sorted.size()));
+  assert(map.distance(map.select(10), map.select(3)) == -7);
+
+  Map<int, int, true> copied{map};
+  assert(copied.is_red_black() && copied.select(5)->first == sorted[5]);
+
+  std::vector<std::pair<int, int>> rows;
+  for (int i = 0; i < 1000; ++i) {
+    rows.push_back({i, i});
+  }
+  copied.assign_sorted(rows.begin(), rows.end());
+  assert(copied.is_red_black() && copied.select(999)->first == 999);
+  assert(copied.rank(500) == 500);
+}
+
+void test_btree_operator_brackets() {
+  BTreeMap<std::string, int> map{{"a", 1}, {"b", 2}};
+  map["c"] = 3;
+  assert(map["a"] == 1 && map["c"] == 3);
+  assert(map.size() == 3);
+  assert(map.contains("b") && !map.contains("d"));
+
+  const BTreeMap<std::string, int> &const_map = map;
+  bool thrown = false;
+  try {
+    const_map["d"];
+  } catch (const std::out_of_range &) {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(map.erase("a") && !map.erase("a"));
+  assert(map.size() == 2 && map.begin()->first == "b");
+}
+
+// Случайные вставки и удаления, ответ сверяется с массивом флагов. Ключей
+// много больше чем влезает в узел, так что узлы делятся и сливаются
+template <class Key> Key btree_key(int i) { return i; }
+
+template <> std::string btree_key<std::string>(int i) {
+  std::string key = std::to_string(i);
+  return std::string(key.size() < 10 ? 10 - key.size() : 0, '0') + key;
+}
+
+template <class Key> void check_btree_against_flags() {
+  const int n = 20000;
+  std::mt19937 gen(7);
+  std::vector<int> present(n, 0);
+  BTreeMap<Key, int> map;
+  std::size_t size = 0;
+  for (int step = 0; step < 4 * n; ++step) {
+    int i = gen() % n;
+    if (step < 2 * n || gen() % 2) {
+      size += !present[i];
+      map[btree_key<Key>(i)] = i;
+      present[i] = 1;
+    } else {
+      assert(map.erase(btree_key<Key>(i)) == static_cast<bool>(present[i]));
+      size -= present[i];
+      present[i] = 0;
+    }
+  }
+  assert(map.size() == size);
+
+  std::size_t count = 0;
+  int previous = -1;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    assert(it->second > previous && present[it->second]);
+    assert(it->first == btree_key<Key>(it->second));
+    previous = it->second;
+    ++count;
+  }
+  assert(count == size);
+
+  // Обход назад от end() дает тот же порядок
+  auto it = map.end();
+  --it;
+  assert(it->second == previous);
+  for (std::size_t i = 1; i < size; ++i) {
+    --it;
+    assert(it->second < previous && present[it->second]);
+    previous = it->second;
+  }
+  assert(it == map.begin());
+
+  for (int i = 0; i < n; i += 97) {
+    auto lower = map.lower_bound(btree_key<Key>(i));
+    int expected = i;
+    while (expected < n && !present[expected]) {
+      ++expected;
+    }
+    if (expected == n) {
+      assert(lower == map.end());
+    } else {
+      assert(lower->second == expected);
+    }
+  }
+
+  BTreeMap<Key, int> copied{map};
+  assert(copied.size() == map.size());
+  for (auto a = map.begin(), b = copied.begin(); a != map.end(); ++a, ++b) {
+    assert(a->first == b->first && &a->second != &b->second);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    assert(map.erase(btree_key<Key>(i)) == static_cast<bool>(present[i]));
+  }
+  assert(map.size() == 0 && map.begin() == map.end());
+  assert(copied.size() == size);
+}
+
+void test_btree_random_operations() {
+  check_btree_against_flags<int>();
+  check_btree_against_flags<std::string>();
+}
+
+void test_btree_is_shallow() {
+  BTreeMap<int, int> map;
+  for (int i = 0; i < 100000; ++i) {
+    map[i] = i;
+  }
+  // В листе 64 пары, во внутреннем узле 64 ключа: 3 уровня на 100000
+  assert(map.height() <= 3);
+  assert(map.lower_bound(100000) == map.end());
+  map.clear();
+  assert(map.height() == 0 && map.size() == 0);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Миллисекунды между двумя отметками Clock
+double ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Истечение записей по времени: ключ - метка времени, каждый раунд
+// удаляется самая старая десятая часть. erase(first, last) против erase(key)
+// по одному
+void bench_expire_range(int n) {
+  std::vector<std::pair<std::int64_t, int>> rows(n);
+  for (int i = 0; i < n; ++i) {
+    rows[i] = {static_cast<std::int64_t>(i) * 1000, i};
+  }
+  Map<std::int64_t, int> by_key(sorted_unique, rows.begin(), rows.end());
+  Map<std::int64_t, int> by_range(sorted_unique, rows.begin(), rows.end());
+
+  auto start = Clock::now();
+  for (int round = 1; round <= 10; ++round) {
+    std::int64_t cutoff = static_cast<std::int64_t>(n) * round / 10 * 1000;
+    for (std::int64_t t = static_cast<std::int64_t>(n) * (round - 1) / 10 * 1000;
+         t < cutoff; t += 1000) {
+      by_key.erase(t);
+    }
+  }
+  auto keyed = Clock::now();
+  for (int round = 1; round <= 10; ++round) {
+    std::int64_t cutoff = static_cast<std::int64_t>(n) * round / 10 * 1000;
+    by_range.erase(by_range.begin(), by_range.lower_bound(cutoff));
+  }
+  auto ranged = Clock::now();
+  assert(by_key.size() == 0 && by_range.size() == 0);
+
+  std::cout << "expire " << n << " entries in 10 rounds: erase(key) "
+            << ms(start, keyed) << " ms, erase(first, last) " << ms(keyed, ranged)
+            << " ms" << std::endl;
+}
+
+// Строка, которая считает, сколько раз ее сравнивали
+struct CountedString {
+  std::string value;
+  static inline std::size_t comparisons = 0;
+
+  bool operator<(const CountedString &other) const {
+    ++comparisons;
+    return value < other.value;
+  }
+  bool operator>(const CountedString &other) const {
+    ++comparisons;
+    return value > other.value;
+  }
+  bool operator==(const CountedString &other) const {
+    ++comparisons;
+    return value == other.value;
+  }
+};
+
+// Полный проход по словарю из n строковых ключей вперед и назад.
+// Запуск: ./main scan [n]
+void bench_string_scan(int n) {
+  std::vector<std::pair<std::string, int>> rows(n);
+  for (int i = 0; i < n; ++i) {
+    rows[i] = {"user:session:" + btree_key<std::string>(i), i};
+  }
+  // вставка в случайном порядке: узлы и строки разбросаны по куче, как в
+  // словаре, который наполнялся постепенно
+  std::shuffle(rows.begin(), rows.end(), std::mt19937(9));
+  Map<std::string, int> map;
+  for (auto &row : rows) {
+    map[row.first] = row.second;
+  }
+
+  auto start = Clock::now();
+  long long sum = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    sum += it->second;
+  }
+  auto forward = Clock::now();
+  auto it = map.end();
+  for (int i = 0; i < n; ++i) {
+    --it;
+    sum -= it->second;
+  }
+  auto backward = Clock::now();
+  assert(sum == 0 && it == map.begin());
+
+  Map<CountedString, int> counted;
+  for (int i = 0; i < std::min(n, 100000); ++i) {
+    counted[CountedString{rows[i].first}] = i;
+  }
+  CountedString::comparisons = 0;
+  for (auto it = counted.begin(); it != counted.end(); ++it) {
+  }
+  std::size_t scan_comparisons = CountedString::comparisons;
+
+  std::cout << "scan " << n << " string keys: forward " << ms(start, forward)
+            << " ms, backward " << ms(forward, backward) << " ms; key comparisons in a scan of "
+            << counted.size() << " keys: " << scan_comparisons << std::endl;
+}
+
+// Перцентили по гистограмме задержек Map<int64_t, count>: select против
+// прохода итератором от begin(), и цена поддержки размеров при вставке
+void bench_percentiles(int n) {
+  std::vector<std::int64_t> latencies(n);
+  std::mt19937_64 gen(5);
+  for (auto &latency : latencies) {
+    latency = gen() % (100 * static_cast<std::int64_t>(n));
+  }
+
+  auto start = Clock::now();
+  Map<std::int64_t, int> plain;
+  for (std::int64_t latency : latencies) {
+    ++plain[latency];
+  }
+  auto plain_built = Clock::now();
+  Map<std::int64_t, int, true> histogram;
+  for (std::int64_t latency : latencies) {
+    ++histogram[latency];
+  }
+  auto built = Clock::now();
+
+  const int queries = 20;
+  std::int64_t walked = 0;
+  for (int q = 1; q <= queries; ++q) {
+    auto it = histogram.begin();
+    for (std::size_t i = histogram.size() * q / (queries + 1); i > 0; --i) {
+      ++it;
+    }
+    walked += it->first;
+  }
+  auto walk_done = Clock::now();
+  std::int64_t selected = 0;
+  for (int q = 1; q <= queries; ++q) {
+    selected += histogram.select(histogram.size() * q / (queries + 1))->first;
+  }
+  auto select_done = Clock::now();
+  assert(walked == selected);
+
+  std::cout << queries << " percentiles over " << histogram.size()
+            << " keys: walk from begin " << ms(built, walk_done) << " ms, select "
+            << ms(walk_done, select_done) << " ms; insert " << n << ": plain "
+            << ms(start, plain_built) << " ms, with sizes "
+            << ms(plain_built, built) << " ms" << std::endl;
+}
+
+// Загрузка n отсортированных строк: по одной через operator[], через
+// assign_sorted и через assign_sorted_parallel
+void bench_bulk_build(int n) {
+  std::vector<std::pair<int, int>> rows(n);
+  for (int i = 0; i < n; ++i) {
+    rows[i] = {i, i};
+  }
+
+  auto start = Clock::now();
+  Map<int, int> one_by_one;
+  for (auto &row : rows) {
+    one_by_one[row.first] = row.second;
+  }
+  auto inserted = Clock::now();
+  Map<int, int> bulk;
+  bulk.assign_sorted(rows.begin(), rows.end());
+  auto built = Clock::now();
+  Map<int, int> parallel;
+  parallel.assign_sorted_parallel(rows.begin(), rows.end());
+  auto built_parallel = Clock::now();
+  assert(bulk.size() == rows.size() && parallel.size() == rows.size());
+
+  std::cout << "load " << n << " sorted rows: operator[] " << ms(start, inserted)
+            << " ms, assign_sorted " << ms(inserted, built)
+            << " ms, assign_sorted_parallel (" << std::thread::hardware_concurrency()
+            << " threads) " << ms(built, built_parallel) << " ms" << std::endl;
+}
+
+// Построение, копирование и очистка словаря из n последовательных ключей.
+// Все обходы итеративные, так что стек не зависит от n. Запуск:
+// ./main stress [n]
+void bench_copy_clear(int n) {
+  auto start = Clock::now();
+  Map<int, int> map;
+  for (int i = 0; i < n; ++i) {
+    map[i] = i;
+  }
+  auto built = Clock::now();
+  Map<int, int> copied{map};
+  auto copied_at = Clock::now();
+  std::size_t found = 0;
+  for (int i = 0; i < n; ++i) {
+    found += copied.contains(i);
+  }
+  auto searched = Clock::now();
+  map.clear();
+  copied.clear();
+  auto cleared = Clock::now();
+  assert(found == static_cast<std::size_t>(n));
+
+  std::cout << n << " keys: build " << ms(start, built) << " ms, copy "
+            << ms(built, copied_at) << " ms, contains " << ms(copied_at, searched)
+            << " ms, clear both " << ms(searched, cleared) << " ms" << std::endl;
+}
+
+// Сколько байт кучи сейчас занято (только для glibc, иначе 0)
+std::size_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+// Map против BTreeMap на n случайных ключах: вставка, поиск в случайном
+// порядке, обход по порядку и память на элемент
+template <class Key> void bench_btree_vs_map(int n, const char *name) {
+  std::vector<Key> keys(n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = btree_key<Key>(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+  std::vector<Key> lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937(2));
+
+  auto run = [&](auto &map, const char *map_name) {
+    std::size_t heap_before = heap_in_use();
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i) {
+      map[keys[i]] = i;
+    }
+    auto inserted = Clock::now();
+    std::size_t heap_after = heap_in_use();
+    std::size_t found = 0;
+    for (const Key &key : lookups) {
+      found += map.contains(key);
+    }
+    auto searched = Clock::now();
+    long long sum = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      sum += it->second;
+    }
+    auto scanned = Clock::now();
+    assert(found == static_cast<std::size_t>(n));
+    assert(sum == static_cast<long long>(n) * (n - 1) / 2);
+
+    std::cout << name << " " << map_name << ": insert " << ms(start, inserted)
+              << " ms, contains " << ms(inserted, searched) << " ms, scan "
+              << ms(searched, scanned) << " ms, "
+              << static_cast<double>(heap_after - heap_before) / n
+              << " bytes/entry" << std::endl;
+  };
+  {
+    Map<Key, int> map;
+    run(map, "Map");
+  }
+  {
+    BTreeMap<Key, int> map;
+    run(map, "BTreeMap");
+  }
+}
+
+// Вставка, поиск и удаление n ключей в порядке по возрастанию, по убыванию
+// и случайном. Запуск: ./main bench [n]
+void bench_insert_orders(int n) {
+  std::vector<int> sorted(n);
+  for (int i = 0; i < n; ++i) {
+    sorted[i] = i;
+  }
+  std::vector<int> reversed(sorted.rbegin(), sorted.rend());
+  std::vector<int> shuffled = sorted;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+  for (auto [name, keys] : {std::pair{"sorted", &sorted}, std::pair{"reversed", &reversed},
+                            std::pair{"random", &shuffled}}) {
+    Map<int, int> map;
+    auto start = Clock::now();
+    for (int key : *keys) {
+      map[key] = key;
+    }
+    auto inserted = Clock::now();
+    std::size_t found = 0;
+    for (int key : shuffled) {
+      found += map.contains(key);
+    }
+    auto searched = Clock::now();
+    for (int key : *keys) {
+      map.erase(key);
+    }
+    auto erased = Clock::now();
+    assert(found == static_cast<std::size_t>(n));
+
+    std::cout << name << ": insert " << ms(start, inserted) << " ms, contains "
+              << ms(inserted, searched) << " ms, erase " << ms(searched, erased)
+              << " ms" << std::endl;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "stress") {
+    bench_copy_clear(argc > 2 ? std::stoi(argv[2]) : 10000000);
+    return 0;
+  }
+  if (argc > 1 && std::string(argv[1]) == "scan") {
+    bench_string_scan(argc > 2 ? std::stoi(argv[2]) : 10000000);
+    return 0;
+  }
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    int n = argc > 2 ? std::stoi(argv[2]) : 1000000;
+    bench_insert_orders(n);
+    bench_bulk_build(n);
+    bench_percentiles(n);
+    bench_expire_range(n);
+    bench_btree_vs_map<int>(n, "int");
+    bench_btree_vs_map<std::string>(n, "string");
+    return 0;
+  }
 
   test_operator_brackets_simple();
   test_operator_brackets_empty_string();
@@ -709,6 +2642,25 @@ int main() {
 
   test_lower_bound();
   test_lower_bound_equal();
+  test_lower_bound_past_end();
+  test_upper_bound_and_equal_range();
+  test_erase_range();
+  test_for_each_in_range();
+  test_decrement_end_iterators();
+
+  test_transparent_lookup();
+  test_emplace();
+
+  test_balanced_sorted_insert();
+  test_erase_keeps_order_and_balance();
+  test_copy_and_clear_large_tree();
+  test_assign_sorted();
+  test_assign_sorted_parallel();
+  test_order_statistics();
+
+  test_btree_operator_brackets();
+  test_btree_random_operations();
+  test_btree_is_shallow();
 
   Map<int, int> map;
   for (int i = 0; i < 20; ++i) {
@@ -0,0 +1,86 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "node_pool.h"
+
+struct Counted {
+  static inline int alive = 0;
+  Counted *self;
+  std::string value;
+
+  explicit Counted(std::string value_) : self(this), value(std::move(value_)) {
+    ++alive;
+  }
+  ~Counted() { --alive; }
+};
+
+void test_reuses_freed_nodes() {
+  NodePool<Counted> pool;
+  Counted *first = pool.create("first");
+  Counted *second = pool.create("second");
+  assert(first->value == "first" && second->value == "second");
+  assert(Counted::alive == 2);
+
+  pool.destroy(first);
+  assert(Counted::alive == 1);
+  // Освобожденный узел выдается первым
+  Counted *third = pool.create("third");
+  assert(third == first && third->self == third);
+  pool.destroy(second);
+  pool.destroy(third);
+  assert(Counted::alive == 0);
+}
+
+void test_nodes_are_distinct_and_aligned() {
+  NodePool<Counted> pool;
+  std::set<Counted *> seen;
+  for (int i = 0; i < 10000; ++i) {
+    Counted *node = pool.create(std::to_string(i));
+    assert(reinterpret_cast<std::uintptr_t>(node) % alignof(Counted) == 0);
+    assert(seen.insert(node).second);
+  }
+  for (Counted *node : seen) {
+    pool.destroy(node);
+  }
+  assert(Counted::alive == 0);
+}
+
+void test_allocate_contiguous() {
+  NodePool<Counted> pool;
+  Counted *slots = pool.allocate_contiguous(100);
+  for (int i = 0; i < 100; ++i) {
+    new (slots + i) Counted(std::to_string(i));
+  }
+  assert(slots[42].value == "42" && Counted::alive == 100);
+  for (int i = 0; i < 100; ++i) {
+    pool.destroy(slots + i);
+  }
+  assert(Counted::alive == 0);
+  // Память блока теперь в списке свободных
+  Counted *reused = pool.create("x");
+  assert(reused >= slots && reused < slots + 100);
+  pool.destroy(reused);
+  assert(pool.allocate_contiguous(0) == nullptr);
+}
+
+void test_move_and_release() {
+  NodePool<int *> pool;
+  int **node = pool.create(nullptr);
+  NodePool<int *> moved{std::move(pool)};
+  moved.destroy(node);
+  assert(moved.create(nullptr) == node);
+  moved.release();
+  assert(moved.create(nullptr) != nullptr);
+}
+
+int main() {
+  test_reuses_freed_nodes();
+  test_nodes_are_distinct_and_aligned();
+  test_allocate_contiguous();
+  test_move_and_release();
+  std::cout << "NodePool: OK" << std::endl;
+  return 0;
+}
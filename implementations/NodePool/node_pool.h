@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// NodePool - пул узлов для списков и деревьев (List, Map). Узлы выдаются
+// подряд из больших блоков, а освобожденные не возвращаются в malloc, а
+// складываются в список свободных и выдаются снова. Вместо malloc/free на
+// каждый узел - сдвиг указателя, и соседние по времени вставки узлы лежат
+// рядом в памяти.
+//
+// Пул принадлежит одному контейнеру и не потокобезопасен. Все блоки
+// освобождаются разом в release() или деструкторе пула; если у узлов
+// тривиальный деструктор, то контейнеру не нужно обходить их по одному.
+template <class Node> class NodePool {
+  static_assert(sizeof(Node) >= sizeof(void *),
+                "free list is stored inside the node memory");
+
+  static constexpr std::size_t kFirstBlock = 16;    // узлов в первом блоке
+  static constexpr std::size_t kMaxBlock = 1 << 14; // дальше блоки не растут
+
+  std::vector<Node *> blocks;
+  Node *cursor = nullptr; // следующий невыданный узел текущего блока
+  Node *block_end = nullptr;
+  void *free_list = nullptr; // в освобожденном узле лежит указатель на следующий
+  std::size_t next_block = kFirstBlock;
+
+  Node *new_block(std::size_t count) {
+    blocks.reserve(blocks.size() + 1);
+    Node *block = static_cast<Node *>(::operator new(
+        count * sizeof(Node), std::align_val_t(alignof(Node))));
+    blocks.push_back(block);
+    return block;
+  }
+
+public:
+  NodePool() = default;
+
+  // Узлы принадлежат пулу, поэтому копировать его нельзя: копия контейнера
+  // заводит свой пул
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  NodePool(NodePool &&other) noexcept { swap(other); }
+
+  NodePool &operator=(NodePool &&other) noexcept {
+    NodePool tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  ~NodePool() { release(); }
+
+  // Память под один узел, конструктор не вызывается
+  Node *allocate() {
+    if (free_list) {
+      Node *node = static_cast<Node *>(free_list);
+      free_list = *static_cast<void **>(free_list);
+      return node;
+    }
+    if (cursor == block_end) {
+      cursor = new_block(next_block);
+      block_end = cursor + next_block;
+      next_block = std::min(next_block * 2, kMaxBlock);
+    }
+    return cursor++;
+  }
+
+  // Память под count узлов подряд отдельным блоком (для построения дерева
+  // целиком); каждый из них потом можно отдать в deallocate
+  Node *allocate_contiguous(std::size_t count) {
+    return count ? new_block(count) : nullptr;
+  }
+
+  // Возвращает память узла (деструктор уже вызван) в список свободных
+  void deallocate(Node *node) {
+    *reinterpret_cast<void **>(node) = free_list;
+    free_list = node;
+  }
+
+  template <class... Args> Node *create(Args &&...args) {
+    Node *node = allocate();
+    try {
+      return new (node) Node(std::forward<Args>(args)...);
+    } catch (...) {
+      deallocate(node);
+      throw;
+    }
+  }
+
+  void destroy(Node *node) {
+    node->~Node();
+    deallocate(node);
+  }
+
+  // Освобождает все блоки разом, деструкторы узлов не вызываются
+  // [O(число блоков)]
+  void release() {
+    for (Node *block : blocks) {
+      ::operator delete(block, std::align_val_t(alignof(Node)));
+    }
+    blocks.clear();
+    cursor = block_end = nullptr;
+    free_list = nullptr;
+    next_block = kFirstBlock;
+  }
+
+  void swap(NodePool &other) noexcept {
+    std::swap(blocks, other.blocks);
+    std::swap(cursor, other.cursor);
+    std::swap(block_end, other.block_end);
+    std::swap(free_list, other.free_list);
+    std::swap(next_block, other.next_block);
+  }
+};
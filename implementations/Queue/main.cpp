@@ -1,15 +1,17 @@
 #include <iostream>
-#include <list>
+
+#include "../Deque/deque.h"
 
 template <class T>
 class Queue {
 private:
-  std::list<T> list;
+  // Блоки по ~4 КБ вместо узла на каждый элемент, как было у std::list
+  Deque<T> deque;
 public:
   // Создает пустую очередь
   Queue()=default;
 
-  Queue(std::initializer_list<T> q) : list(q) {}
+  Queue(std::initializer_list<T> q) : deque(q) {}
 
   // Создает новую очередь, являющююся глубокой копией очереди other [O(n)]
   Queue(const Queue& other)=default;
@@ -29,39 +31,37 @@ public:
 
   // Возвращает размер очереди (сколько памяти уже занято)
   std::size_t size() const{
-    return list.size();
+    return deque.size();
   };
 
   // Проверяет является ли контейнер пустым
   bool empty() const{
-    return list.empty();
+    return deque.empty();
   };
 
   // Получает ссылку на первый элемент очереди
   T& front(){
-    return list.front();
+    return deque.front();
   };
 
   // Получает ссылку на последний элемент очереди
   T& back(){
-    return list.back();
+    return deque.back();
   };
 
   // Добавляет элемент в конец очереди.
   void push(const T& x){
-    list.push_back(x);
+    deque.push_back(x);
   };
 
   // Удаляет элемент из начала очереди. Возвращает удаленный элемент.
   T pop(){
-    T tmp = list.front();
-    list.pop_front();
-    return tmp;
+    return deque.pop_front();
   };
 
   // Меняет содержимое с другой очередью. q1.swap(q2);
   void swap(Queue& other){
-    list.swap(other.list);
+    deque.swap(other.deque);
   };
 
   void dump_from(Queue<T>& q){
@@ -1,12 +1,15 @@
 #include <iostream>
-#include <vector>
 #include <algorithm>
 
+#include "../Deque/deque.h"
+
 
 template <class T>
 class Stack {
 private:
-std::vector<T> stack;
+// Элементы не переезжают при росте, ссылка из top() остается
+// действительной после новых push
+Deque<T> stack;
 
 public:
   // Создает пустой стэк
@@ -51,9 +54,7 @@ public:
 
   // Удаляет последний элемент стэка. Возвращает удаленный элемент.
   T pop(){
-    T tmp = stack[stack.size()-1];
-    stack.pop_back();
-    return tmp;
+    return stack.pop_back();
   };
 
   // Меняет содержимое с другим стэком. s1.swap(s2);
@@ -1,62 +1,387 @@
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <list>
+#include <new>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <initializer_list>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Аллокатор узлов UnorderedMap, который считает выделения памяти. Через
+// NodeAllocations::count можно проверить, что rehash не выделяет узлы заново.
+struct NodeAllocations {
+  static inline std::size_t count = 0;
+};
+
+template <class T> struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <class U> CountingAllocator(const CountingAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    ++NodeAllocations::count;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *p, std::size_t n) { std::allocator<T>{}.deallocate(p, n); }
+
+  template <class U> bool operator==(const CountingAllocator<U> &) const { return true; }
+  template <class U> bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+// Элемент корзины UnorderedMap. При CacheHash рядом с парой хранится ее
+// полный хеш: rehash не считает хеши заново, а ключи сравниваются только
+// если совпали хеши. Без CacheHash хеш каждый раз считается по ключу.
+template <class Pair, bool CacheHash> struct ChainNode {
+  Pair pair;
+  std::size_t hash_code;
+
+  // пара создается прямо в узле из args
+  template <class... Args>
+  ChainNode(std::size_t hash, Args &&...args)
+      : pair(std::forward<Args>(args)...), hash_code(hash) {}
+
+  template <class Hash> std::size_t hash(const Hash &) const { return hash_code; }
+
+  void set_hash(std::size_t hash) { hash_code = hash; }
+
+  bool same_hash(std::size_t hash) const { return hash_code == hash; }
+};
+
+template <class Pair> struct ChainNode<Pair, false> {
+  Pair pair;
+
+  template <class... Args>
+  ChainNode(std::size_t, Args &&...args) : pair(std::forward<Args>(args)...) {}
+
+  template <class Hash> std::size_t hash(const Hash &hasher) const {
+    return hasher(pair.first);
+  }
+
+  void set_hash(std::size_t) {}
+
+  bool same_hash(std::size_t) const { return true; }
+};
+
+// Прозрачный хеш для строковых ключей: UnorderedMap<std::string, V, StringHash>
+// ищет по const char* и std::string_view без создания временной std::string
+struct StringHash {
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+// Массив корзин UnorderedMap кусками по kChunk корзин. Удвоение большой
+// таблицы не переносит корзины: новые куски выделяются и заполняются по мере
+// того, как rehash создает корзины через construct_until. Таблица меньше
+// kChunk - это один кусок ровно ее размера, он переезжает целиком (не больше
+// kChunk корзин). Поэтому ни одна вставка не платит O(число корзин).
+template <class Bucket> class BucketTable {
+public:
+  static constexpr int kChunkShift = 10;
+  static constexpr std::size_t kChunk = std::size_t(1) << kChunkShift;
+
+private:
+  std::vector<Bucket *> chunks_;
+  std::size_t size_ = 0;        // число корзин, включая еще не созданные
+  std::size_t constructed_ = 0; // созданы корзины [0, constructed_)
+
+  std::size_t chunk_size() const { return std::min(size_, kChunk); }
+
+  static Bucket *allocate(std::size_t n) { return std::allocator<Bucket>{}.allocate(n); }
+
+  static void deallocate(Bucket *chunk, std::size_t n) {
+    std::allocator<Bucket>{}.deallocate(chunk, n);
+  }
+
+public:
+  BucketTable() = default;
+
+  // size - степень двойки, все корзины создаются сразу
+  explicit BucketTable(std::size_t size) {
+    size_ = size;
+    construct_until(size);
+  }
+
+  // через BucketTable(): если копирование корзины бросит, деструктор
+  // освободит уже созданное
+  BucketTable(const BucketTable &other) : BucketTable() {
+    size_ = other.size_;
+    chunks_.reserve(other.chunks_.size());
+    for (; constructed_ < other.constructed_; ++constructed_) {
+      if (constructed_ % kChunk == 0) {
+        chunks_.push_back(allocate(chunk_size()));
+      }
+      new (&(*this)[constructed_]) Bucket(other[constructed_]);
+    }
+  }
+
+  BucketTable(BucketTable &&other) noexcept { swap(other); }
+
+  BucketTable &operator=(BucketTable other) {
+    swap(other);
+    return *this;
+  }
+
+  ~BucketTable() {
+    for (std::size_t i = 0; i < constructed_; ++i) {
+      (*this)[i].~Bucket();
+    }
+    for (Bucket *chunk : chunks_) {
+      deallocate(chunk, chunk_size());
+    }
+  }
+
+  void swap(BucketTable &other) {
+    chunks_.swap(other.chunks_);
+    std::swap(size_, other.size_);
+    std::swap(constructed_, other.constructed_);
+  }
+
+  std::size_t size() const { return size_; }
+
+  Bucket &operator[](std::size_t i) {
+    return chunks_[i >> kChunkShift][i & (kChunk - 1)];
+  }
+
+  const Bucket &operator[](std::size_t i) const {
+    return chunks_[i >> kChunkShift][i & (kChunk - 1)];
+  }
+
+  // Удваивает число корзин. Новые корзины [size(), 2 * size()) у большой
+  // таблицы еще не созданы, у маленькой создаются сразу.
+  void grow() {
+    if (size_ >= kChunk) {
+      size_ *= 2;
+      return;
+    }
+    Bucket *chunk = allocate(2 * size_);
+    for (std::size_t i = 0; i < 2 * size_; ++i) {
+      new (chunk + i) Bucket();
+    }
+    for (std::size_t i = 0; i < size_; ++i) {
+      chunk[i].swap(chunks_[0][i]);
+      chunks_[0][i].~Bucket();
+    }
+    deallocate(chunks_[0], size_);
+    chunks_[0] = chunk;
+    size_ *= 2;
+    constructed_ = size_;
+  }
+
+  // Создает корзины до n (не включая)
+  void construct_until(std::size_t n) {
+    for (; constructed_ < n; ++constructed_) {
+      if (constructed_ % kChunk == 0) {
+        chunks_.push_back(allocate(chunk_size()));
+      }
+      new (&(*this)[constructed_]) Bucket();
+    }
+  }
+};
 
-template <class Key, class Value> class UnorderedMap {
+// Для арифметических ключей std::hash почти бесплатный, поэтому по умолчанию
+// хеш хранится только для остальных типов (строк и т.п.)
+template <class Key, class Value, class Hash = std::hash<Key>,
+          bool CacheHash = !std::is_arithmetic<Key>::value>
+class UnorderedMap {
 public:
   class Iterator;
   class ConstIterator;
 private:
   using ValueType = std::pair<Key, Value>;
-  std::vector<std::list<ValueType>> data;
+  using Node = ChainNode<ValueType, CacheHash>;
+  using Bucket = std::list<Node, CountingAllocator<Node>>;
+  // число корзин всегда степень двойки, корзина = hash & (data.size() - 1)
+  BucketTable<Bucket> data;
   std::size_t size_ = 0;
 
+  // Инкрементальный rehash. При удвоении корзина i старой таблицы делится
+  // только между корзинами i и i + old_size_ новой, поэтому старая таблица -
+  // это просто первая половина data. Корзины [0, split_) уже разнесены,
+  // остальные переносятся по rehash_step_ штук за каждую изменяющую операцию.
+  // Корзина i + old_size_ создается, только когда разносится корзина i.
+  std::size_t rehash_step_ = 0; // 0 - переносим все корзины сразу
+  std::size_t old_size_ = 0;    // размер старой таблицы, 0 - rehash не идет
+  std::size_t split_ = 0;
+
+  // Первая и последняя непустые корзины (имеют смысл только при size_ != 0),
+  // чтобы begin(), end() и итераторы создавались за O(1)
+  std::size_t first_ = 0;
+  std::size_t last_ = 0;
+
+  // Вызывается после добавления элемента в корзину b
+  void bucket_filled(std::size_t b){
+    if(size_ == 1){
+      first_ = last_ = b;
+    }
+    else{
+      first_ = std::min(first_, b);
+      last_ = std::max(last_, b);
+    }
+  }
+
+  // Вызывается после удаления элемента из корзины b
+  void bucket_emptied(std::size_t b){
+    if(size_ == 0 || !data[b].empty()){
+      return;
+    }
+    while(data[first_].empty()){
+      ++first_;
+    }
+    while(data[last_].empty()){
+      --last_;
+    }
+  }
+
   void CollisionsCheck(){
     if(size_ >= 4*data.size()){
       reallocation();
     }
   }
 
- void reallocation(){
-    int old_vec_size = data.size();
-    data.resize(data.size()*2);
-    for(int i = 0; i < old_vec_size; ++i){
-      for(auto it = data[i].begin(); it != data[i].end();){
-        int index = std::hash<Key>{}((*it).first);
-        if((index % data.size()) >= old_vec_size){
-          data[old_vec_size + i].push_back(*it);
-          it = data[i].erase(it);
-        }
-        else{
-          ++it;
-        }
+  void reallocation(){
+    finish_rehash(); // прошлый rehash должен закончиться до следующего удвоения
+    old_size_ = data.size();
+    split_ = 0;
+    data.grow(); // старые корзины остаются на месте, новые создаст split_bucket
+    if(rehash_step_ == 0){
+      finish_rehash();
+    }
+  }
+
+  // Переносит в корзину i + old_size_ все элементы корзины i, которым там
+  // место. Узлы перевешиваются через splice, без копирования и выделения памяти.
+  void split_bucket(std::size_t i){
+    data.construct_until(old_size_ + i + 1);
+    for(auto it = data[i].begin(); it != data[i].end();){
+      if(it->hash(Hash{}) & old_size_){
+        auto next = std::next(it);
+        data[old_size_ + i].splice(data[old_size_ + i].end(), data[i], it);
+        last_ = std::max(last_, old_size_ + i);
+        it = next;
+      }
+      else{
+        ++it;
+      }
+    }
+    bucket_emptied(i);
+  }
+
+  // Разносит не больше buckets корзин старой таблицы
+  void rehash_step(std::size_t buckets){
+    while(old_size_ != 0 && buckets-- > 0){
+      split_bucket(split_++);
+      if(split_ == old_size_){
+        old_size_ = 0;
+        split_ = 0;
+      }
+    }
+  }
+
+  void finish_rehash(){
+    rehash_step(old_size_);
+  }
+
+  // Индекс корзины, в которой лежит (или должен лежать) ключ с таким хешем.
+  // Если его корзина в старой таблице еще не разнесена, то ищем в ней.
+  std::size_t bucket(std::size_t hash) const {
+    if(old_size_ != 0 && (hash & (old_size_ - 1)) >= split_){
+      return hash & (old_size_ - 1);
+    }
+    return hash & (data.size() - 1);
+  }
+
+  // Поиск, удаление и вставка написаны для любого K, который хешируется Hash
+  // и сравнивается с Key через ==. Публичные методы принимают Key, а если
+  // Hash::is_transparent, то и любой такой K.
+  template <class K> bool contains_key(const K &key) const {
+    std::size_t hash = Hash{}(key);
+    for (const auto &it : data[bucket(hash)]) {
+      if (it.same_hash(hash) && it.pair.first == key) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <class K> Iterator find_key(const K &key) {
+    std::size_t hash = Hash{}(key);
+    std::size_t b = bucket(hash);
+    for(auto it = data[b].begin(); it!=data[b].end(); ++it){
+      if(it->same_hash(hash) && it->pair.first == key){
+        return Iterator(it, data, b, first_, last_);
       }
     }
+    return end();
   }
 
-  int Hash(const Key& key){
-    return (std::hash<Key>{}(key))/data.size();
+  template <class K> bool erase_key(const K &key) {
+    rehash_step(rehash_step_);
+    std::size_t hash = Hash{}(key);
+    auto &collisions = data[bucket(hash)];
+    for (auto it = collisions.begin(); it != collisions.end(); ++it) {
+      if (it->same_hash(hash) && it->pair.first == key) {
+        collisions.erase(it);
+        size_--;
+        bucket_emptied(bucket(hash));
+        return true;
+      }
+    }
+    return false;
   }
 
-  Iterator FindByHash(const Key &key, const int &hash){
-    for(auto it = data[hash].begin(); it!=data[hash].end(); ++it){
-      if(key == (*it).first){
-        return Iterator(it, data, hash);    
+  // Ищет ключ, и если его нет, создает элемент прямо в новом узле: ключ из
+  // key, значение из args. Хеш считается один раз. Возвращает итератор на
+  // элемент и true, если элемент был добавлен.
+  template <class K, class... Args>
+  std::pair<Iterator, bool> try_emplace_key(K &&key, Args &&...args) {
+    rehash_step(rehash_step_);
+    std::size_t hash = Hash{}(key);
+    std::size_t b = bucket(hash);
+    for(auto it = data[b].begin(); it!=data[b].end(); ++it){
+      if(it->same_hash(hash) && it->pair.first == key){
+        return {Iterator(it, data, b, first_, last_), false};
       }
     }
+
+    auto node = data[b].emplace(data[b].end(), hash, std::piecewise_construct,
+                                std::forward_as_tuple(std::forward<K>(key)),
+                                std::forward_as_tuple(std::forward<Args>(args)...));
+    size_++;
+    bucket_filled(b);
+    CollisionsCheck(); // rehash переносит узлы через splice, node остается валидным
+    return {Iterator(node, data, bucket(hash), first_, last_), true};
+  }
+
+  static std::size_t RoundUpToPowerOfTwo(int n) {
+    std::size_t size = 1;
+    while (size < static_cast<std::size_t>(n)) {
+      size *= 2;
+    }
+    return size;
   }
 
 public:
-  // Создает пустой словарь
-  UnorderedMap(int capacity = 5) : data(capacity) {}
+  // Создает пустой словарь (число корзин округляется вверх до степени двойки)
+  UnorderedMap(int capacity = 5) : data(RoundUpToPowerOfTwo(capacity)) {}
 
   // Создает новый UnorderedMap, являющийся глубокой копией other [O(n)]
   // UnorderedMap<std::string, int>  map;
@@ -67,6 +392,11 @@ public:
   UnorderedMap(const UnorderedMap &other) {
     data = other.data;
     size_ = other.size_;
+    rehash_step_ = other.rehash_step_;
+    old_size_ = other.old_size_;
+    split_ = other.split_;
+    first_ = other.first_;
+    last_ = other.last_;
   };
 
   // initializer_list
@@ -75,21 +405,18 @@ public:
     for(const auto& it : other){
       second[it.first] = it.second;
     }
-    std::swap(data, second.data);
-    std::swap(size_, second.size_);
+    swap(second);
   }
 
   // Конструктор перемещения
   UnorderedMap(UnorderedMap &&other) {
-    std::swap(data, other.data);
-    std::swap(size_, other.size_);
+    swap(other);
   };
 
   // Перезаписывает текущий словарь словарем other
   UnorderedMap &operator=(const UnorderedMap &other) {
     UnorderedMap tmp{other};
-    std::swap(data, tmp.data);
-    std::swap(size_, tmp.size_);
+    swap(tmp);
 
     return *this;
   };
@@ -97,41 +424,64 @@ public:
   // Присваивание перемещением
   UnorderedMap &operator=(UnorderedMap &&other) {
     UnorderedMap tmp{std::move(other)};
-    std::swap(data, tmp.data);
-    std::swap(size_, tmp.size_);
+    swap(tmp);
 
     return *this;
   };
 
   ~UnorderedMap() = default;
 
-  // Возвращает итератор на первый элемент
+  // Меняет текуший контейнер с контейнером other
+  void swap(UnorderedMap &other) {
+    data.swap(other.data);
+    std::swap(size_, other.size_);
+    std::swap(rehash_step_, other.rehash_step_);
+    std::swap(old_size_, other.old_size_);
+    std::swap(split_, other.split_);
+    std::swap(first_, other.first_);
+    std::swap(last_, other.last_);
+  }
+
+  // Включает инкрементальный rehash: при росте таблицы каждая изменяющая
+  // операция (operator[], insert, erase) переносит не больше buckets корзин.
+  // 0 (по умолчанию) - вся таблица переносится сразу внутри одной операции.
+  void set_rehash_step(std::size_t buckets) {
+    rehash_step_ = buckets;
+  }
+
+  // Идет ли сейчас перенос корзин
+  bool rehashing() const { return old_size_ != 0; }
+
+  // Количество корзин
+  std::size_t bucket_count() const { return data.size(); }
+
+  // Количество элементов в корзине n
+  std::size_t bucket_size(std::size_t n) const { return data[n].size(); }
+
+  // Возвращает итератор на первый элемент [O(1)]
   Iterator begin() {
-    for(int i = 0; i < data.size(); ++i){
-      if(data[i].empty() != true){
-        return Iterator(data[i].begin(), data, i);
-      }
+    if(size_ == 0){
+      return Iterator(data);
     }
-    return Iterator(data);
+    return Iterator(data[first_].begin(), data, first_, first_, last_);
   };
 
   // Возвращает константный итератор на первый элемент
   ConstIterator begin() const {
-    return ConstIterator(begin());
+    return ConstIterator(const_cast<UnorderedMap *>(this)->begin());
   };
 
-  // Возвращает итератор обозначающий конец контейнера (за последнимэлементом)
+  // Возвращает итератор обозначающий конец контейнера (за последнимэлементом) [O(1)]
   Iterator end() {
-    for(int i = data.size()-1; i>0; --i){
-      if(data[i].empty() != true)
-      return Iterator(data[i].end(), data, i);
+    if(size_ == 0){
+      return Iterator(data);
     }
-    return Iterator(data);
+    return Iterator(data[last_].end(), data, last_, first_, last_);
   };
 
   // // Возвращает константный итератор, обозначающий конец контейнера
   ConstIterator end() const {
-    return ConstIterator(end());
+    return ConstIterator(const_cast<UnorderedMap *>(this)->end());
   };
 
   // Возвращает размер UnorderedMap (сколько элементов добавлено)
@@ -141,11 +491,11 @@ public:
   bool empty() const { return size_ == 0; };
 
   // Возвращает элемент по ключу. Если отсутсвует, выбрасывает исключение
-  const Value &operator[](Key key) const {
-    int index = std::hash<Key>{}(key);
-    for (const auto &it : data[index % data.size()]) {
-      if (it.first == key) {
-        return it.second;
+  const Value &operator[](const Key &key) const {
+    std::size_t hash = Hash{}(key);
+    for (const auto &it : data[bucket(hash)]) {
+      if (it.same_hash(hash) && it.pair.first == key) {
+        return it.pair.second;
       }
     }
     throw std::out_of_range("There is no key like yours!!!");
@@ -154,42 +504,31 @@ public:
   // Возвращает ссылку на элемент по Key (позволяет менять элемент). Если
   // элемент с таким ключом отсутствует, создает его и инициализирует дефолтным
   // значением map["something"] = 75;
-  Value &operator[](Key key) {
-    int index = std::hash<Key>{}(key);
-    for (auto &it : data[index % data.size()]) {
-      if (it.first == key) {
-        return it.second;
-      }
-    }
+  Value &operator[](const Key &key) { return try_emplace_key(key).first->second; };
 
-    data[index % data.size()].push_back({key, Value{}});
-    size_++;
-    CollisionsCheck();
-    return data[index % data.size()].back().second;
+  // То же, но ключ перемещается в словарь, а не копируется
+  Value &operator[](Key &&key) {
+    return try_emplace_key(std::move(key)).first->second;
   };
 
   // Проверяет есть ли в контейнере элемент с таким Key
-  bool contains(const Key &key) const {
-    int index = std::hash<Key>{}(key);
-    for (const auto &it : data[index % data.size()]) {
-      if (it.first == key) {
-        return true;
-      }
-    }
-    return false;
-  };
+  bool contains(const Key &key) const { return contains_key(key); };
+
+  // Гетерогенный contains: map.contains(std::string_view{"x"}) без временной
+  // std::string. Доступен только с прозрачным хешем (например StringHash).
+  template <class K, class H = Hash, class = typename H::is_transparent>
+  bool contains(const K &key) const {
+    return contains_key(key);
+  }
 
   // Возвращяет Итератор на элемент который ищем, если нет такого элемента
   // возвращает итератор на последный элемент
-  Iterator find(const Key &key) {
-    int index = std::hash<Key>{}(key);
-    for(auto it = data[index % data.size()].begin(); it!=data[index % data.size()].end(); ++it){
-      if(key == (*it).first){
-        return Iterator(it, data, index % data.size());    
-      }
-    }
-    return end();
-  };
+  Iterator find(const Key &key) { return find_key(key); };
+
+  template <class K, class H = Hash, class = typename H::is_transparent>
+  Iterator find(const K &key) {
+    return find_key(key);
+  }
 
   // Добавляет новый элемент с ключем и значением, если нет уже существуюшего
   // элемента с таким же ключом Map<int, std::string> c =
@@ -199,16 +538,62 @@ public:
   //   };
   // c.(5,"something");
   // возвращает false, потому что элмемент с key = 5 уже существует․
-  bool insert(const Key &k, const Value &v) {
-    if (contains(k)) {
-      return false;
+  bool insert(const Key &k, const Value &v) { return try_emplace_key(k, v).second; };
+
+  // Если ключа k нет, то создает элемент, значение которого конструируется
+  // прямо в узле из args. Если ключ есть, ничего не делает (args не трогает).
+  // map.try_emplace("key", 10, 'x'); // Value = std::string("xxxxxxxxxx")
+  template <class... Args>
+  std::pair<Iterator, bool> try_emplace(const Key &k, Args &&...args) {
+    return try_emplace_key(k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<Iterator, bool> try_emplace(Key &&k, Args &&...args) {
+    return try_emplace_key(std::move(k), std::forward<Args>(args)...);
+  }
+
+  // Создает пару из args прямо в узле и добавляет ее, если такого ключа еще
+  // нет (иначе узел удаляется). map.emplace(std::piecewise_construct, ...)
+  template <class... Args> std::pair<Iterator, bool> emplace(Args &&...args) {
+    rehash_step(rehash_step_);
+    Bucket single;
+    single.emplace_back(0, std::forward<Args>(args)...);
+    const Key &key = single.front().pair.first;
+    std::size_t hash = Hash{}(key);
+    std::size_t b = bucket(hash);
+    for(auto it = data[b].begin(); it!=data[b].end(); ++it){
+      if(it->same_hash(hash) && it->pair.first == key){
+        return {Iterator(it, data, b, first_, last_), false};
+      }
     }
-    int index = std::hash<Key>{}(k);
-    data[index % data.size()].push_back({k, v});
+
+    single.front().set_hash(hash);
+    auto node = single.begin();
+    data[b].splice(data[b].end(), single, node);
     size_++;
+    bucket_filled(b);
     CollisionsCheck();
-    return true;
-  };
+    return {Iterator(node, data, bucket(hash), first_, last_), true};
+  }
+
+  // Добавляет элемент, а если ключ уже есть - присваивает ему obj
+  template <class M>
+  std::pair<Iterator, bool> insert_or_assign(const Key &k, M &&obj) {
+    auto result = try_emplace_key(k, std::forward<M>(obj));
+    if (!result.second) {
+      result.first->second = std::forward<M>(obj);
+    }
+    return result;
+  }
+
+  template <class M> std::pair<Iterator, bool> insert_or_assign(Key &&k, M &&obj) {
+    auto result = try_emplace_key(std::move(k), std::forward<M>(obj));
+    if (!result.second) {
+      result.first->second = std::forward<M>(obj);
+    }
+    return result;
+  }
 
   // Удаляет элемент по ключу и возвращает результат операции
   // UnorderedMap<int, std::string> c =
@@ -222,17 +607,11 @@ public:
   //       {1, "one" }, {2, "two" }, {3, "three"},
   //             {5, "five"}, {6,"six"  }
   //   }; результат после erase
-  bool erase(const Key &key) {
-    int index = std::hash<Key>{}(key);
-    auto &collisions = data[index % data.size()];
-    for (auto it = collisions.begin(); it != collisions.end(); ++it) {
-      if (key == it->first) {
-        collisions.erase(it);
-        size_--;
-        return true;
-      }
-    }
-    return false;
+  bool erase(const Key &key) { return erase_key(key); }
+
+  template <class K, class H = Hash, class = typename H::is_transparent>
+  bool erase(const K &key) {
+    return erase_key(key);
   }
 
   class Iterator {
@@ -241,11 +620,11 @@ public:
     using difference_type = std::ptrdiff_t;
     using pointer = value_type *;
     using reference = value_type &;
-    using ListIt = typename std::list<ValueType>::iterator;
-    using Vector = std::vector<std::list<ValueType>>;
+    using ListIt = typename Bucket::iterator;
+    using Vector = BucketTable<Bucket>;
 
   private:
-    Vector &data;  // ссылка на вектор
+    Vector &data;  // ссылка на корзины словаря
     ListIt listit; // итератор на лист
     int index = 0; // индекс вектора на котором находится listit в конкретный момент
     int max_index; // наибольший индекс не пустого листа, в комментах max
@@ -253,24 +632,10 @@ public:
 
   public:
     // конструктор на случай пустого вектора
-    Iterator(Vector& vec) : data(vec), listit(data[data.size()-1].end()), index(data.size()-1), max_index(index), min_index(index) {}
-    // обычный конструктор для begin() end() find
-    Iterator(ListIt it, Vector& vec, int index_) : data(vec), listit(it), index(index_) {
-      // через этот цикл нахожу в векторе первый непустой лист и прсиваиваю min его значение
-      for(int i = 0; i < data.size(); ++i){
-        if(data[i].empty() != true){
-          min_index = i;
-          break;
-        }
-      }
-      // здесь уже поиск происходит с конца
-      for(int i = data.size()-1; i>0; --i){
-        if(data[i].empty() != true){
-          max_index = i;
-          break;
-        }
-      }
-    } // P.S. Можно было сделать 4 конструктора эти 2 и еще +2. Один из тех двух сразу бы получал min а другой max
+    Iterator(Vector& vec) : data(vec), listit(data[0].end()), index(0), max_index(index), min_index(index) {}
+    // обычный конструктор для begin() end() find, min и max словарь хранит сам
+    Iterator(ListIt it, Vector& vec, int index_, int min_, int max_)
+        : data(vec), listit(it), index(index_), max_index(max_), min_index(min_) {}
 
     Iterator &operator++() {
       ++listit;
@@ -311,9 +676,9 @@ public:
     bool operator==(const Iterator &other) { return listit == other.listit; };
 
     // разыменование (как с указателями): *it = 42; или std::cout << *it;
-    std::pair<Key, Value> &operator*() { return *listit; };
+    std::pair<Key, Value> &operator*() { return listit->pair; };
 
-    std::pair<Key, Value> *operator->() { return &(*listit); };
+    std::pair<Key, Value> *operator->() { return &listit->pair; };
   };
   class ConstIterator {
     friend UnorderedMap;
@@ -372,83 +737,550 @@ UnorderedMap<K,V> merge(const UnorderedMap<K,V>& u1, const UnorderedMap<K,V>& u2
   return u3;
 }
 
-void test_operator_brackets_simple() {
-  UnorderedMap<std::string, std::string> map;
-  map["Nikolay"] = "teacher";
-  assert(map["Nikolay"] == "teacher");
-}
+// Хеш-таблица с открытой адресацией (в стиле Swiss table). В отличие от
+// UnorderedMap все элементы лежат в одном непрерывном массиве slots, а на
+// каждый слот приходится один байт метаданных в ctrl:
+//   kEmpty   - слот пустой,
+//   kDeleted - из слота удалили элемент (надгробие),
+//   0..127   - слот занят, значение = 7 младших бит хеша ключа (H2).
+// Поиск идет группами по 16 байт ctrl начиная с позиции H1 = hash >> 7: одно
+// SSE2 сравнение отсеивает сразу 16 кандидатов, полный ключ сравнивается
+// только для слотов, у которых совпал H2. Без SSE2 используется скалярная
+// реализация Group. Таблица заполняется не больше чем на 7/8.
+//
+// capacity_ всегда вида 2^k - 1, а ctrl длиннее на kGroupWidth байт: за
+// kSentinel лежат копии первых kGroupWidth - 1 байт, поэтому группу можно
+// читать с любой позиции без проверки выхода за конец массива.
+template <class Key, class Value> class FlatUnorderedMap {
+public:
+  class Iterator;
+  class ConstIterator;
+private:
+  using ValueType = std::pair<Key, Value>;
+  using ctrl_t = signed char;
 
-void test_operator_brackets_empty_string() {
-  UnorderedMap<std::string, std::string> map;
-  map[""] = "";
-  assert(map[""] == "");
-}
+  static constexpr ctrl_t kEmpty = -128;
+  static constexpr ctrl_t kDeleted = -2;
+  static constexpr ctrl_t kSentinel = -1; // стоит после последнего слота, на нем останавливается итератор
+  static constexpr std::size_t kGroupWidth = 16;
+  static constexpr std::size_t kMinCapacity = kGroupWidth - 1;
 
-void test_operator_brackets_key_not_exist() {
-  UnorderedMap<std::string, std::string> map;
-  assert(map["Nikolay"] == "");
-}
+  static int TrailingZeros(std::uint32_t mask) { return __builtin_ctz(mask); }
+  static int LeadingZeros(std::uint32_t mask) { return __builtin_clz(mask) - 16; }
 
-void test_operator_brackets_key_not_exist_const() {
-  const UnorderedMap<std::string, std::string> map;
-  bool exception_thrown{};
+  // 16 байт ctrl, каждый метод возвращает битовую маску подходящих слотов
+#if defined(__SSE2__)
+  struct Group {
+    __m128i ctrl;
 
-  // проверка, что исключение будет выброшено
-  try {
-    assert(map["Nikolay"] == "");
-  } catch (std::out_of_range) {
-    exception_thrown = true;
-  }
-  assert(exception_thrown);
-}
+    explicit Group(const ctrl_t *pos)
+        : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))) {}
 
-void test_contains_simple() {
-  UnorderedMap<std::string, std::string> map;
-  map["Nikolay"] = "teacher";
-  assert(map.contains("Nikolay"));
-}
+    std::uint32_t Match(ctrl_t h2) const {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+    }
 
-void test_contains_false() {
-  UnorderedMap<std::string, std::string> map;
-  assert(!map.contains("Nikolay"));
-}
+    std::uint32_t MaskEmpty() const { return Match(kEmpty); }
 
-void test_find() {
-  UnorderedMap<std::string, std::string> map;
-  map["Nikolay"] = "teacher";
-  map["John"] = "programmer";
+    // kEmpty и kDeleted меньше kSentinel, а занятые слоты больше
+    std::uint32_t MaskEmptyOrDeleted() const {
+      return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(kSentinel), ctrl));
+    }
+  };
+#else
+  struct Group {
+    ctrl_t ctrl[kGroupWidth];
 
-  assert(map.find("Nikolay") != map.end());
-}
+    explicit Group(const ctrl_t *pos) { std::copy(pos, pos + kGroupWidth, ctrl); }
 
-void test_find_not_found() {
-  UnorderedMap<std::string, std::string> map;
-  map["Nikolay"] = "teacher";
-  map["John"] = "programmer";
+    std::uint32_t Match(ctrl_t h2) const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= std::uint32_t(ctrl[i] == h2) << i;
+      }
+      return mask;
+    }
 
-  assert(map.find("Alex") == map.end());
-}
+    std::uint32_t MaskEmpty() const { return Match(kEmpty); }
 
-void test_insert_false() {
-  UnorderedMap<int, std::string> c;
-  c[1] = "one";
-  c[2] = "two";
-  c[3] = "tree";
-  c[4] = "four";
-  c[5] = "five";
-  assert(c.insert(5, "something") == false);
-}
+    std::uint32_t MaskEmptyOrDeleted() const {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < kGroupWidth; ++i) {
+        mask |= std::uint32_t(ctrl[i] < kSentinel) << i;
+      }
+      return mask;
+    }
+  };
+#endif
 
-void test_insert_accessed() {
-  UnorderedMap<int, std::string> c;
-  c[1] = "one";
-  c[2] = "two";
-  c[3] = "tree";
-  c[4] = "four";
-  c[5] = "five";
-  bool res = c.insert(7, "something");
-  assert(res == true);
-}
+  // Последовательность групп для пробирования: смещения растут на 16, 32,
+  // 48... (треугольные числа), при capacity_ + 1 = 2^k обходятся все группы
+  struct ProbeSeq {
+    std::size_t mask;
+    std::size_t offset_;
+    std::size_t index = 0;
+
+    ProbeSeq(std::size_t hash, std::size_t mask_) : mask(mask_), offset_(hash & mask_) {}
+
+    std::size_t offset() const { return offset_; }
+    std::size_t offset(int i) const { return (offset_ + i) & mask; }
+
+    void next() {
+      index += kGroupWidth;
+      offset_ = (offset_ + index) & mask;
+    }
+  };
+
+  ctrl_t *ctrl = EmptyCtrl();
+  ValueType *slots = nullptr;
+  std::size_t capacity_ = 0; // всегда 2^k - 1 (или 0), он же маска для индексов
+  std::size_t size_ = 0;
+  std::size_t growth_left_ = 0; // сколько пустых слотов можно занять до rehash
+
+  // ctrl для таблицы без слотов, чтобы begin() == end() работали без проверок
+  static ctrl_t *EmptyCtrl() {
+    static ctrl_t empty_ctrl[1] = {kSentinel};
+    return empty_ctrl;
+  }
+
+  static bool IsFull(ctrl_t c) { return c >= 0; }
+
+  // std::hash<int> возвращает само число, поэтому перемешиваем биты, иначе
+  // соседние ключи получат одинаковый H1 и будут толпиться в одном месте
+  static std::size_t Hash(const Key &key) {
+    std::uint64_t h = std::hash<Key>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<std::size_t>(h);
+  }
+
+  static std::size_t H1(std::size_t hash) { return hash >> 7; }
+  static ctrl_t H2(std::size_t hash) { return static_cast<ctrl_t>(hash & 0x7F); }
+
+  static std::size_t MaxLoad(std::size_t capacity) {
+    return capacity - capacity / 8;
+  }
+
+  static std::size_t NormalizeCapacity(std::size_t n) {
+    std::size_t capacity = kMinCapacity;
+    while (MaxLoad(capacity) < n) {
+      capacity = capacity * 2 + 1;
+    }
+    return capacity;
+  }
+
+  void allocate(std::size_t capacity) {
+    capacity_ = capacity;
+    ctrl = new ctrl_t[capacity_ + kGroupWidth];
+    std::fill(ctrl, ctrl + capacity_ + kGroupWidth, kEmpty);
+    ctrl[capacity_] = kSentinel;
+    slots = static_cast<ValueType *>(::operator new(capacity_ * sizeof(ValueType)));
+    growth_left_ = MaxLoad(capacity_) - size_;
+  }
+
+  void deallocate() {
+    if (capacity_ == 0) {
+      return;
+    }
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      if (IsFull(ctrl[i])) {
+        slots[i].~ValueType();
+      }
+    }
+    delete[] ctrl;
+    ::operator delete(slots);
+    ctrl = EmptyCtrl();
+    slots = nullptr;
+    capacity_ = 0;
+    growth_left_ = 0;
+  }
+
+  // Меняет байт ctrl слота i и его копию за kSentinel (если она есть)
+  void SetCtrl(std::size_t i, ctrl_t h) {
+    ctrl[i] = h;
+    ctrl[((i - (kGroupWidth - 1)) & capacity_) + (kGroupWidth - 1)] = h;
+  }
+
+  // Индекс слота с ключом key или capacity_, если такого ключа нет
+  std::size_t FindIndex(const Key &key, std::size_t hash) const {
+    if (capacity_ == 0) {
+      return capacity_;
+    }
+    ProbeSeq seq(H1(hash), capacity_);
+    ctrl_t h2 = H2(hash);
+    // пустой слот всегда найдется, т.к. таблица заполнена не больше чем на 7/8
+    while (true) {
+      Group group(ctrl + seq.offset());
+      for (std::uint32_t match = group.Match(h2); match != 0; match &= match - 1) {
+        std::size_t index = seq.offset(TrailingZeros(match));
+        if (slots[index].first == key) {
+          return index;
+        }
+      }
+      if (group.MaskEmpty() != 0) {
+        return capacity_;
+      }
+      seq.next();
+    }
+  }
+
+  // Первый пустой или удаленный слот на пути пробирования
+  std::size_t FindFirstNonFull(std::size_t hash) const {
+    ProbeSeq seq(H1(hash), capacity_);
+    while (true) {
+      std::uint32_t mask = Group(ctrl + seq.offset()).MaskEmptyOrDeleted();
+      if (mask != 0) {
+        return seq.offset(TrailingZeros(mask));
+      }
+      seq.next();
+    }
+  }
+
+  // Находит слот для нового ключа (которого точно нет в таблице), при
+  // необходимости делает rehash, и создает в нем элемент из args. Слот
+  // помечается занятым только после конструктора: если он бросит, то в
+  // таблице не останется слота с неинициализированной памятью
+  template <class... Args> std::size_t EmplaceNew(std::size_t hash, Args &&...args) {
+    if (capacity_ == 0) {
+      allocate(kMinCapacity);
+    }
+    std::size_t pos = FindFirstNonFull(hash);
+    if (growth_left_ == 0 && ctrl[pos] != kDeleted) {
+      // если таблица забита в основном надгробиями, хватит rehash-а того же размера
+      rehash(size_ < MaxLoad(capacity_) / 2 ? capacity_ : capacity_ * 2 + 1);
+      pos = FindFirstNonFull(hash);
+    }
+    new (slots + pos) ValueType(std::forward<Args>(args)...);
+    if (ctrl[pos] == kEmpty) {
+      --growth_left_;
+    }
+    SetCtrl(pos, H2(hash));
+    ++size_;
+    return pos;
+  }
+
+  void rehash(std::size_t new_capacity) {
+    ctrl_t *old_ctrl = ctrl;
+    ValueType *old_slots = slots;
+    std::size_t old_capacity = capacity_;
+
+    allocate(new_capacity);
+    for (std::size_t i = 0; i < old_capacity; ++i) {
+      if (IsFull(old_ctrl[i])) {
+        std::size_t hash = Hash(old_slots[i].first);
+        std::size_t pos = FindFirstNonFull(hash);
+        SetCtrl(pos, H2(hash));
+        new (slots + pos) ValueType(std::move(old_slots[i]));
+        old_slots[i].~ValueType();
+      }
+    }
+    delete[] old_ctrl;
+    ::operator delete(old_slots);
+  }
+
+public:
+  // Создает пустой словарь, в который без rehash-а влезет capacity элементов
+  FlatUnorderedMap(int capacity = 5) { allocate(NormalizeCapacity(capacity)); }
+
+  // Создает новый FlatUnorderedMap, являющийся глубокой копией other [O(capacity)]
+  FlatUnorderedMap(const FlatUnorderedMap &other) {
+    if (other.capacity_ == 0) {
+      return;
+    }
+    size_ = other.size_;
+    allocate(other.capacity_);
+    growth_left_ = other.growth_left_;
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      if (IsFull(other.ctrl[i])) {
+        new (slots + i) ValueType(other.slots[i]);
+      }
+    }
+    std::copy(other.ctrl, other.ctrl + capacity_ + kGroupWidth, ctrl);
+  }
+
+  // initializer_list
+  FlatUnorderedMap(std::initializer_list<std::pair<Key, Value>> other)
+      : FlatUnorderedMap(other.size()) {
+    for (const auto &it : other) {
+      (*this)[it.first] = it.second;
+    }
+  }
+
+  // Конструктор перемещения
+  FlatUnorderedMap(FlatUnorderedMap &&other) { swap(other); }
+
+  // Перезаписывает текущий словарь словарем other
+  FlatUnorderedMap &operator=(const FlatUnorderedMap &other) {
+    FlatUnorderedMap tmp{other};
+    swap(tmp);
+    return *this;
+  }
+
+  // Присваивание перемещением
+  FlatUnorderedMap &operator=(FlatUnorderedMap &&other) {
+    FlatUnorderedMap tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  ~FlatUnorderedMap() { deallocate(); }
+
+  void swap(FlatUnorderedMap &other) {
+    std::swap(ctrl, other.ctrl);
+    std::swap(slots, other.slots);
+    std::swap(capacity_, other.capacity_);
+    std::swap(size_, other.size_);
+    std::swap(growth_left_, other.growth_left_);
+  }
+
+  // Возвращает итератор на первый элемент
+  Iterator begin() {
+    Iterator it(ctrl, slots);
+    it.SkipEmpty();
+    return it;
+  }
+
+  ConstIterator begin() const {
+    return ConstIterator(const_cast<FlatUnorderedMap *>(this)->begin());
+  }
+
+  // Возвращает итератор обозначающий конец контейнера (указывает на kSentinel)
+  Iterator end() { return Iterator(ctrl + capacity_, slots + capacity_); }
+
+  ConstIterator end() const {
+    return ConstIterator(const_cast<FlatUnorderedMap *>(this)->end());
+  }
+
+  std::size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  // Количество слотов
+  std::size_t capacity() const { return capacity_; }
+
+  // Возвращает элемент по ключу. Если отсутсвует, выбрасывает исключение
+  const Value &operator[](const Key &key) const {
+    std::size_t index = FindIndex(key, Hash(key));
+    if (index == capacity_) {
+      throw std::out_of_range("There is no key like yours!!!");
+    }
+    return slots[index].second;
+  }
+
+  // Возвращает ссылку на элемент по Key, если его нет - создает со значением
+  // по умолчанию
+  Value &operator[](const Key &key) {
+    std::size_t hash = Hash(key);
+    std::size_t index = FindIndex(key, hash);
+    if (index != capacity_) {
+      return slots[index].second;
+    }
+    index = EmplaceNew(hash, key, Value{});
+    return slots[index].second;
+  }
+
+  bool contains(const Key &key) const {
+    return FindIndex(key, Hash(key)) != capacity_;
+  }
+
+  // Возвращает итератор на элемент или end(), если такого ключа нет
+  Iterator find(const Key &key) {
+    std::size_t index = FindIndex(key, Hash(key));
+    return Iterator(ctrl + index, slots + index);
+  }
+
+  // Добавляет элемент, если элемента с таким ключом еще нет
+  bool insert(const Key &k, const Value &v) {
+    std::size_t hash = Hash(k);
+    if (FindIndex(k, hash) != capacity_) {
+      return false;
+    }
+    EmplaceNew(hash, k, v);
+    return true;
+  }
+
+  // Удаляет элемент по ключу и возвращает результат операции
+  bool erase(const Key &key) {
+    std::size_t index = FindIndex(key, Hash(key));
+    if (index == capacity_) {
+      return false;
+    }
+    slots[index].~ValueType();
+    --size_;
+    // если вокруг слота нет окна из kGroupWidth занятых подряд слотов, то
+    // ни один поиск не проходил через него дальше и надгробие не нужно
+    std::size_t index_before = (index - kGroupWidth) & capacity_;
+    std::uint32_t empty_after = Group(ctrl + index).MaskEmpty();
+    std::uint32_t empty_before = Group(ctrl + index_before).MaskEmpty();
+    bool was_never_full = empty_before != 0 && empty_after != 0 &&
+                          static_cast<std::size_t>(TrailingZeros(empty_after) +
+                                                   LeadingZeros(empty_before)) < kGroupWidth;
+    if (was_never_full) {
+      SetCtrl(index, kEmpty);
+      ++growth_left_;
+    } else {
+      SetCtrl(index, kDeleted);
+    }
+    return true;
+  }
+
+  class Iterator {
+    friend FlatUnorderedMap;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type *;
+    using reference = value_type &;
+
+  private:
+    ctrl_t *ctrl_;    // байт метаданных текущего слота
+    ValueType *slot_; // сам слот
+
+    // пропускает пустые и удаленные слоты, kSentinel > kDeleted > kEmpty
+    void SkipEmpty() {
+      while (*ctrl_ < kSentinel) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+  public:
+    Iterator(ctrl_t *ctrl, ValueType *slot) : ctrl_(ctrl), slot_(slot) {}
+
+    Iterator &operator++() {
+      ++ctrl_;
+      ++slot_;
+      SkipEmpty();
+      return *this;
+    }
+
+    Iterator &operator--() {
+      do {
+        --ctrl_;
+        --slot_;
+      } while (!IsFull(*ctrl_));
+      return *this;
+    }
+
+    bool operator!=(const Iterator &other) const { return ctrl_ != other.ctrl_; }
+    bool operator==(const Iterator &other) const { return ctrl_ == other.ctrl_; }
+
+    std::pair<Key, Value> &operator*() { return *slot_; }
+
+    std::pair<Key, Value> *operator->() { return slot_; }
+  };
+
+  class ConstIterator {
+    friend FlatUnorderedMap;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Key;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type *;
+    using reference = value_type &;
+
+  private:
+    Iterator it;
+
+  public:
+    ConstIterator(Iterator iter) : it(iter) {}
+
+    ConstIterator &operator++() {
+      ++it;
+      return *this;
+    }
+
+    ConstIterator &operator--() {
+      --it;
+      return *this;
+    }
+
+    bool operator!=(const ConstIterator &other) const { return it != other.it; }
+    bool operator==(const ConstIterator &other) const { return it == other.it; }
+
+    const std::pair<Key, Value> &operator*() { return *it; }
+
+    const std::pair<Key, Value> *operator->() { return &(*it); }
+  };
+};
+
+void test_operator_brackets_simple() {
+  UnorderedMap<std::string, std::string> map;
+  map["Nikolay"] = "teacher";
+  assert(map["Nikolay"] == "teacher");
+}
+
+void test_operator_brackets_empty_string() {
+  UnorderedMap<std::string, std::string> map;
+  map[""] = "";
+  assert(map[""] == "");
+}
+
+void test_operator_brackets_key_not_exist() {
+  UnorderedMap<std::string, std::string> map;
+  assert(map["Nikolay"] == "");
+}
+
+void test_operator_brackets_key_not_exist_const() {
+  const UnorderedMap<std::string, std::string> map;
+  bool exception_thrown{};
+
+  // проверка, что исключение будет выброшено
+  try {
+    assert(map["Nikolay"] == "");
+  } catch (std::out_of_range) {
+    exception_thrown = true;
+  }
+  assert(exception_thrown);
+}
+
+void test_contains_simple() {
+  UnorderedMap<std::string, std::string> map;
+  map["Nikolay"] = "teacher";
+  assert(map.contains("Nikolay"));
+}
+
+void test_contains_false() {
+  UnorderedMap<std::string, std::string> map;
+  assert(!map.contains("Nikolay"));
+}
+
+void test_find() {
+  UnorderedMap<std::string, std::string> map;
+  map["Nikolay"] = "teacher";
+  map["John"] = "programmer";
+
+  assert(map.find("Nikolay") != map.end());
+}
+
+void test_find_not_found() {
+  UnorderedMap<std::string, std::string> map;
+  map["Nikolay"] = "teacher";
+  map["John"] = "programmer";
+
+  assert(map.find("Alex") == map.end());
+}
+
+void test_insert_false() {
+  UnorderedMap<int, std::string> c;
+  c[1] = "one";
+  c[2] = "two";
+  c[3] = "tree";
+  c[4] = "four";
+  c[5] = "five";
+  assert(c.insert(5, "something") == false);
+}
+
+void test_insert_accessed() {
+  UnorderedMap<int, std::string> c;
+  c[1] = "one";
+  c[2] = "two";
+  c[3] = "tree";
+  c[4] = "four";
+  c[5] = "five";
+  bool res = c.insert(7, "something");
+  assert(res == true);
+}
 
 void test_erase_simple() {
   UnorderedMap<std::string, int> map;
@@ -540,12 +1372,524 @@ void test_reallocation() {
   }
   std::cout << map.size() << std::endl;
 
-  auto *data = (std::vector<std::list<std::pair<int, int>>> *)&map;
-  assert(data->size() == 40);
-  assert((*data)[0].size() == 2); // for type `int` hash has perfect distribution
+  // 5 корзин округляются до 8, дальше удвоения на 32 и 64 элементах
+  assert(map.bucket_count() == 32);
+  assert(map.bucket_size(0) == 3); // for type `int` hash has perfect distribution
+}
+
+void test_incremental_rehash() {
+  UnorderedMap<int, int> map;
+  map.set_rehash_step(1);
+  bool was_rehashing = false;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = i;
+    was_rehashing = was_rehashing || map.rehashing();
+    // пока корзины переносятся, все ключи должны находиться
+    if (map.rehashing()) {
+      for (int j = 0; j <= i; j += 7) {
+        assert(map.contains(j));
+        assert(map.find(j)->second == j);
+      }
+      assert(!map.contains(i + 1));
+    }
+  }
+  assert(was_rehashing);
+
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    ++count;
+  }
+  assert(count == map.size());
+
+  for (int i = 0; i < 1000; i += 2) {
+    assert(map.erase(i));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    assert(map.contains(i) == (i % 2 == 1));
+  }
+  assert(map.size() == 500);
+}
+
+// Копия, сделанная посреди rehash-а, получает только уже созданные корзины
+// нового сегмента и доделывает rehash сама
+void test_copy_during_incremental_rehash() {
+  UnorderedMap<int, int> map;
+  map.set_rehash_step(1);
+  int n = 0;
+  while (!map.rehashing() || map.bucket_count() < 256) {
+    map[n] = n;
+    ++n;
+  }
+  UnorderedMap<int, int> copied(map);
+  assert(copied.rehashing() && copied.size() == map.size());
+  for (int i = n; i < 2 * n; ++i) {
+    copied[i] = i;
+  }
+  for (int i = 0; i < 2 * n; ++i) {
+    assert(copied.find(i)->second == i && map.contains(i) == (i < n));
+  }
+
+  // пустой словарь посреди rehash-а
+  for (int i = 0; i < n; ++i) {
+    assert(map.erase(i));
+  }
+  assert(map.empty() && map.begin() == map.end());
+  UnorderedMap<int, int> moved(std::move(map));
+  moved[1] = 1;
+  assert(moved.size() == 1 && moved.begin()->second == 1);
+}
+
+void test_rehash_without_allocations() {
+  for (std::size_t step : {0, 1}) {
+    UnorderedMap<std::string, std::string> map;
+    map.set_rehash_step(step);
+    std::size_t before = NodeAllocations::count;
+    for (int i = 0; i < 1000; ++i) {
+      map[std::to_string(i)] = std::string(100, 'x');
+    }
+    for (int i = 0; i < 1000; ++i) {
+      map.erase(std::to_string(i + 1000)); // шаги rehash-а без вставок
+    }
+    assert(map.bucket_count() > 5);
+    assert(!map.rehashing());
+    // один узел на элемент, rehash-и ничего не выделили
+    assert(NodeAllocations::count - before == 1000);
+  }
+}
+
+void test_begin_end_tracking() {
+  UnorderedMap<int, int> map(1024);
+  assert(map.begin() == map.end());
+
+  // все ключи в корзине 0
+  map[0] = 0;
+  map[1024] = 1;
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    ++count;
+  }
+  assert(count == 2);
+
+  map[500] = 2;
+  map[1000] = 3;
+  map.erase(0);
+  map.erase(1024);
+  assert(map.begin()->first == 500);
+  map.erase(1000);
+  auto it = map.begin();
+  ++it;
+  assert(it == map.end());
+  assert(map.find(7) == map.end());
+  map.erase(500);
+  assert(map.begin() == map.end());
+}
+
+void test_transparent_lookup() {
+  UnorderedMap<std::string, int, StringHash> map;
+  map["first"] = 1;
+  map["second"] = 2;
+  std::string_view view = "second";
+
+  assert(map.contains(view));
+  assert(map.contains("first"));
+  assert(!map.contains(std::string_view{"third"}));
+  assert(map.find(view)->second == 2);
+  assert(map.find("third") == map.end());
+  assert(map.erase(std::string_view{"first"}));
+  assert(!map.contains("first"));
+  assert(map.size() == 1);
+
+  std::string key = "moved key that does not fit into SSO";
+  map[std::move(key)] = 3;
+  assert(map.contains("moved key that does not fit into SSO"));
 }
 
-int main() {
+// Хеш, который считает свои вызовы
+struct CountingStringHash {
+  static inline std::size_t calls = 0;
+
+  std::size_t operator()(const std::string &key) const {
+    ++calls;
+    return std::hash<std::string>{}(key);
+  }
+};
+
+// Хеш с заполненными старшими битами, которые раньше терялись в int
+struct HighBitsHash {
+  std::size_t operator()(int key) const {
+    return ~static_cast<std::size_t>(0) - static_cast<std::size_t>(key);
+  }
+};
+
+// Значение, которое считает свои копирования
+struct CopyCounter {
+  static inline int copies = 0;
+  std::vector<int> payload;
+
+  CopyCounter() = default;
+  CopyCounter(int size, int value) : payload(size, value) {}
+  CopyCounter(const CopyCounter &other) : payload(other.payload) { ++copies; }
+  CopyCounter(CopyCounter &&other) = default;
+  CopyCounter &operator=(const CopyCounter &other) {
+    payload = other.payload;
+    ++copies;
+    return *this;
+  }
+  CopyCounter &operator=(CopyCounter &&other) = default;
+};
+
+void test_emplace() {
+  CountingStringHash::calls = 0;
+  CopyCounter::copies = 0;
+  UnorderedMap<std::string, CopyCounter, CountingStringHash> map;
+
+  auto [it, inserted] = map.try_emplace("first", 1000, 7);
+  assert(inserted && it->second.payload.size() == 1000);
+  assert(!map.try_emplace("first", 1, 1).second);
+  assert(map["first"].payload.size() == 1000);
+
+  assert(map.emplace(std::piecewise_construct, std::forward_as_tuple("second"),
+                     std::forward_as_tuple(10, 2)).second);
+  assert(!map.emplace("second", CopyCounter(5, 5)).second);
+  assert(map["second"].payload.size() == 10);
+
+  assert(map.insert_or_assign("third", CopyCounter(3, 3)).second);
+  assert(!map.insert_or_assign("third", CopyCounter(4, 4)).second);
+  assert(map["third"].payload.size() == 4);
+
+  assert(map.size() == 3);
+  assert(CopyCounter::copies == 0);
+  // по одному хешу на каждый вызов
+  assert(CountingStringHash::calls == 9);
+}
+
+void test_cached_hash() {
+  CountingStringHash::calls = 0;
+  UnorderedMap<std::string, int, CountingStringHash> cached;
+  for (int i = 0; i < 1000; ++i) {
+    cached[std::to_string(i)] = i;
+  }
+  // по одному хешу на вставку, rehash-и хеши не пересчитывали
+  assert(CountingStringHash::calls == 1000);
+
+  CountingStringHash::calls = 0;
+  UnorderedMap<std::string, int, CountingStringHash, false> not_cached;
+  for (int i = 0; i < 1000; ++i) {
+    not_cached[std::to_string(i)] = i;
+  }
+  assert(CountingStringHash::calls > 1000);
+  for (int i = 0; i < 1000; ++i) {
+    assert(cached[std::to_string(i)] == not_cached[std::to_string(i)]);
+  }
+}
+
+void test_full_width_hash() {
+  UnorderedMap<int, int, HighBitsHash> map;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = i;
+  }
+  for (int i = 0; i < 1000; ++i) {
+    assert(map.contains(i));
+    assert(map.find(i)->second == i);
+  }
+  assert(!map.contains(1000));
+  assert(map.size() == 1000);
+}
+
+void test_flat_operator_brackets() {
+  FlatUnorderedMap<std::string, std::string> map;
+  map["Nikolay"] = "teacher";
+  map[""] = "";
+  assert(map["Nikolay"] == "teacher");
+  assert(map[""] == "");
+  assert(map["John"] == "");
+  assert(map.size() == 3);
+}
+
+void test_flat_key_not_exist_const() {
+  const FlatUnorderedMap<std::string, std::string> map;
+  bool exception_thrown{};
+  try {
+    assert(map["Nikolay"] == "");
+  } catch (const std::out_of_range &) {
+    exception_thrown = true;
+  }
+  assert(exception_thrown);
+}
+
+void test_flat_insert_find_erase() {
+  FlatUnorderedMap<int, std::string> c = {{1, "one"}, {2, "two"}, {3, "three"}};
+  assert(c.insert(3, "something") == false);
+  assert(c.insert(7, "seven") == true);
+  assert(c.find(7)->second == "seven");
+  assert(c.find(42) == c.end());
+  assert(c.erase(2) == true);
+  assert(c.erase(2) == false);
+  assert(!c.contains(2));
+  assert(c.size() == 3);
+}
+
+void test_flat_reallocation() {
+  FlatUnorderedMap<int, int> map;
+  for (int i = 0; i < 1000; ++i) {
+    map[i] = i;
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    map.erase(i);
+  }
+  // надгробия не должны мешать ни поиску, ни повторной вставке
+  for (int i = 0; i < 1000; ++i) {
+    assert(map.contains(i) == (i % 2 == 1));
+  }
+  for (int i = 1000; i < 3000; ++i) {
+    map[i] = i;
+  }
+  assert(map.size() == 2500);
+  assert(map.capacity() * 7 / 8 >= map.size());
+  assert(((map.capacity() + 1) & map.capacity()) == 0);
+
+  std::size_t count = 0;
+  long long sum = 0;
+  for (const auto &it : map) {
+    sum += it.second;
+    ++count;
+  }
+  assert(count == map.size());
+  assert(sum == 250000LL + (1000LL + 2999LL) * 2000 / 2);
+}
+
+void test_flat_copy_and_move() {
+  FlatUnorderedMap<std::string, int> map;
+  map["something"] = 69;
+  map["anything"] = 199;
+  FlatUnorderedMap<std::string, int> copied{map};
+  assert(copied["something"] == 69);
+  assert(copied.size() == map.size());
+
+  FlatUnorderedMap<std::string, int> moved{std::move(map)};
+  assert(map.empty());
+  assert(!map.contains("something"));
+  assert(map.begin() == map.end());
+  assert(moved["anything"] == 199);
+  map["again"] = 1;
+  assert(map.size() == 1);
+}
+
+// Значение, которое считает живые объекты и бросает при создании (но не
+// при перемещении), пока fail == true
+struct ThrowingValue {
+  static inline int alive = 0;
+  static inline bool fail = false;
+  std::string text;
+
+  ThrowingValue() : ThrowingValue("") {}
+  ThrowingValue(const char *text_) : text(text_) { created(); }
+  ThrowingValue(const ThrowingValue &other) : text(other.text) { created(); }
+  ThrowingValue(ThrowingValue &&other) noexcept : text(std::move(other.text)) { ++alive; }
+  ThrowingValue &operator=(const ThrowingValue &) = default;
+  ~ThrowingValue() { --alive; }
+
+  void created() {
+    if (fail) {
+      throw std::runtime_error("no value");
+    }
+    ++alive;
+  }
+};
+
+void test_flat_throwing_value() {
+  ThrowingValue::alive = 0;
+  {
+    FlatUnorderedMap<int, ThrowingValue> map;
+    ThrowingValue value("value");
+    // каждая третья вставка бросает, в том числе те, что делают rehash
+    for (int i = 0; i < 300; ++i) {
+      ThrowingValue::fail = i % 3 == 0;
+      bool thrown = false;
+      try {
+        if (i % 2) {
+          map[i];
+        } else {
+          map.insert(i, value);
+        }
+      } catch (const std::runtime_error &) {
+        thrown = true;
+      }
+      ThrowingValue::fail = false;
+      assert(thrown == (i % 3 == 0) && map.contains(i) == !thrown);
+    }
+    assert(map.size() == 200 && ThrowingValue::alive == 201);
+    std::size_t count = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      assert(it->first % 3 != 0);
+      ++count;
+    }
+    assert(count == map.size());
+
+    FlatUnorderedMap<int, ThrowingValue> copied{map};
+    for (int i = 0; i < 300; ++i) {
+      map.erase(i);
+    }
+    assert(map.empty() && ThrowingValue::alive == 201);
+  }
+  assert(ThrowingValue::alive == 0);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Миллисекунды между двумя отметками Clock
+double ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Бенчмарк цепочечного UnorderedMap против FlatUnorderedMap: вставка,
+// успешный и неуспешный поиск. Запуск: ./main bench
+template <class MapType, class MakeKey>
+void bench_map(const char *name, int n, MakeKey make_key) {
+  std::vector<decltype(make_key(0))> keys;
+  keys.reserve(2 * n);
+  for (int i = 0; i < 2 * n; ++i) {
+    keys.push_back(make_key(i));
+  }
+
+  MapType map;
+  auto start = Clock::now();
+  for (int i = 0; i < n; ++i) {
+    map[keys[2 * i]] = i;
+  }
+  auto inserted = Clock::now();
+  std::size_t found = 0;
+  for (int i = 0; i < n; ++i) {
+    found += map.contains(keys[2 * i]);
+  }
+  auto hits = Clock::now();
+  for (int i = 0; i < n; ++i) {
+    found += map.contains(keys[2 * i + 1]);
+  }
+  auto misses = Clock::now();
+  assert(found == static_cast<std::size_t>(n));
+
+  std::cout << name << ": insert " << ms(start, inserted) << " ms, hit "
+            << ms(inserted, hits) << " ms, miss " << ms(hits, misses) << " ms"
+            << std::endl;
+}
+
+// Самая долгая одиночная вставка: при обычном rehash-е она переносит всю
+// таблицу, при инкрементальном - не больше rehash_step корзин
+void bench_rehash_latency(int n, std::size_t rehash_step) {
+  UnorderedMap<std::string, int> map;
+  map.set_rehash_step(rehash_step);
+  double worst = 0, total = 0;
+  for (int i = 0; i < n; ++i) {
+    std::string key = "key_" + std::to_string(i);
+    auto start = Clock::now();
+    map[key] = i;
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    worst = std::max(worst, us);
+    total += us;
+  }
+  std::cout << "rehash step " << rehash_step << ": worst insert " << worst
+            << " us, total " << total / 1000 << " ms" << std::endl;
+}
+
+// Неуспешный find возвращает end(), его цена не должна зависеть от числа
+// корзин: одни и те же элементы в таблицах разного размера
+void bench_find_miss(int n) {
+  for (int buckets : {1 << 10, 1 << 16, 1 << 20}) {
+    UnorderedMap<int, int> map(buckets);
+    for (int i = 0; i < 100; ++i) {
+      map[i] = i;
+    }
+    std::size_t found = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i) {
+      found += map.find(i + 100) != map.end();
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    assert(found == 0);
+    std::cout << "find miss, " << buckets << " buckets: " << ns / n << " ns" << std::endl;
+  }
+}
+
+// Разбирает лог и ищет каждое слово в словаре: по std::string_view (без
+// аллокаций) и через временную std::string. Если путь к логу не передан, то
+// генерируется лог из n строк.
+void bench_log_lookup(int n, const char *path) {
+  std::string log;
+  if (path != nullptr) {
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    log = buffer.str();
+  } else {
+    for (int i = 0; i < n; ++i) {
+      log += "2024-05-01T12:00:00 INFO user_session_" + std::to_string(i % 1000) +
+             " GET /api/v1/items/" + std::to_string(i % 5000) + " status=200\n";
+    }
+  }
+
+  UnorderedMap<std::string, int, StringHash> known;
+  known["INFO"] = 0;
+  known["GET"] = 0;
+  for (int i = 0; i < 1000; i += 2) {
+    known["user_session_" + std::to_string(i)] = 0;
+  }
+
+  std::vector<std::string_view> tokens;
+  std::string_view rest = log;
+  while (!rest.empty()) {
+    std::size_t end = rest.find_first_of(" \n");
+    if (end == std::string_view::npos) {
+      end = rest.size();
+    }
+    if (end != 0) {
+      tokens.push_back(rest.substr(0, end));
+    }
+    rest.remove_prefix(std::min(end + 1, rest.size()));
+  }
+
+  std::size_t by_view = 0, by_string = 0;
+  auto start = Clock::now();
+  for (std::string_view token : tokens) {
+    by_view += known.contains(token);
+  }
+  auto viewed = Clock::now();
+  for (std::string_view token : tokens) {
+    by_string += known.contains(std::string(token));
+  }
+  auto copied = Clock::now();
+  assert(by_view == by_string);
+
+  std::cout << "log lookup, " << tokens.size() << " tokens: string_view "
+            << ms(start, viewed) << " ms, std::string " << ms(viewed, copied)
+            << " ms" << std::endl;
+}
+
+void bench_flat_vs_chained(int n) {
+#if defined(__SSE2__)
+  std::cout << "FlatUnorderedMap probing: SSE2" << std::endl;
+#else
+  std::cout << "FlatUnorderedMap probing: scalar" << std::endl;
+#endif
+  auto int_key = [](int i) { return i * 7; };
+  auto string_key = [](int i) { return "key_" + std::to_string(i); };
+  bench_map<UnorderedMap<int, int>>("chained <int>", n, int_key);
+  bench_map<FlatUnorderedMap<int, int>>("flat    <int>", n, int_key);
+  bench_map<UnorderedMap<std::string, int>>("chained <string>", n, string_key);
+  bench_map<FlatUnorderedMap<std::string, int>>("flat    <string>", n, string_key);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    int n = argc > 2 ? std::stoi(argv[2]) : 1000000;
+    bench_flat_vs_chained(n);
+    bench_rehash_latency(n, 0);
+    bench_rehash_latency(n, 4);
+    bench_find_miss(n);
+    bench_log_lookup(n, argc > 3 ? argv[3] : nullptr);
+    return 0;
+  }
+
   test_operator_brackets_simple();
   test_operator_brackets_empty_string();
   test_operator_brackets_key_not_exist();
@@ -574,6 +1918,21 @@ int main() {
   test_copy_constructor();
 
   test_reallocation();
+  test_incremental_rehash();
+  test_copy_during_incremental_rehash();
+  test_rehash_without_allocations();
+  test_cached_hash();
+  test_begin_end_tracking();
+  test_transparent_lookup();
+  test_emplace();
+  test_full_width_hash();
+
+  test_flat_operator_brackets();
+  test_flat_key_not_exist_const();
+  test_flat_insert_find_erase();
+  test_flat_reallocation();
+  test_flat_copy_and_move();
+  test_flat_throwing_value();
 
   UnorderedMap<int, int> map;
   for(int i = 0; i < 40; ++i){
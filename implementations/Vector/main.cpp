@@ -1,29 +1,563 @@
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
 
-template <class T> class Vector {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+// Политика роста Vector: новая емкость - capacity * Num / Den, но не меньше
+// нужной. С RoundToSizeClass емкость еще округляется вверх до класса
+// размеров аллокатора (4 класса на каждую степень двойки, как в jemalloc и
+// tcmalloc): хвост блока, который malloc все равно выделит, не пропадает.
+template <std::size_t Num, std::size_t Den, bool RoundToSizeClass = false>
+struct GrowthFactor {
+  static_assert(Num > Den, "capacity must grow");
+
+  // Сколько элементов поместится в блок, выделенный под n элементов
+  static std::size_t fit(std::size_t n, std::size_t elem_size){
+    if constexpr (!RoundToSizeClass){
+      return n;
+    }
+    else{
+      std::size_t bytes = n * elem_size;
+      std::size_t step = 16;
+      while(step * 8 < bytes){
+        step *= 2;
+      }
+      return (bytes + step - 1) / step * step / elem_size;
+    }
+  }
+
+  static std::size_t grow(std::size_t capacity, std::size_t required, std::size_t elem_size){
+    return fit(std::max(required, capacity * Num / Den), elem_size);
+  }
+};
+
+using GrowTwice = GrowthFactor<2, 1>;
+using GrowOneAndHalf = GrowthFactor<3, 2>;
+
+// Регистры SIMD для int, float и double: AVX2 (8 int / 4 double за
+// инструкцию), если компилятор собирает с -mavx2 (-march=native), иначе SSE2
+// (4 int / 2 double, есть на любом x86-64). Для остальных типов и без SSE2
+// kEnabled == false, и алгоритмы Vector работают обычным циклом.
+template <class T> struct Simd {
+  static constexpr bool kEnabled = false;
+};
+
+#if defined(__AVX2__)
+template <> struct Simd<int> {
+  using Reg = __m256i;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 8;
+  static Reg load(const int* p){ return _mm256_loadu_si256(reinterpret_cast<const Reg*>(p)); }
+  static void store(int* p, Reg a){ _mm256_storeu_si256(reinterpret_cast<Reg*>(p), a); }
+  static Reg broadcast(int x){ return _mm256_set1_epi32(x); }
+  static Reg add(Reg a, Reg b){ return _mm256_add_epi32(a, b); }
+  static Reg min(Reg a, Reg b){ return _mm256_min_epi32(a, b); }
+  static Reg max(Reg a, Reg b){ return _mm256_max_epi32(a, b); }
+  // По биту на каждую равную пару элементов
+  static unsigned equal_mask(Reg a, Reg b){
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+  }
+};
+
+template <> struct Simd<float> {
+  using Reg = __m256;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 8;
+  static Reg load(const float* p){ return _mm256_loadu_ps(p); }
+  static void store(float* p, Reg a){ _mm256_storeu_ps(p, a); }
+  static Reg broadcast(float x){ return _mm256_set1_ps(x); }
+  static Reg add(Reg a, Reg b){ return _mm256_add_ps(a, b); }
+  static Reg min(Reg a, Reg b){ return _mm256_min_ps(a, b); }
+  static Reg max(Reg a, Reg b){ return _mm256_max_ps(a, b); }
+  static unsigned equal_mask(Reg a, Reg b){ return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+};
+
+template <> struct Simd<double> {
+  using Reg = __m256d;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 4;
+  static Reg load(const double* p){ return _mm256_loadu_pd(p); }
+  static void store(double* p, Reg a){ _mm256_storeu_pd(p, a); }
+  static Reg broadcast(double x){ return _mm256_set1_pd(x); }
+  static Reg add(Reg a, Reg b){ return _mm256_add_pd(a, b); }
+  static Reg min(Reg a, Reg b){ return _mm256_min_pd(a, b); }
+  static Reg max(Reg a, Reg b){ return _mm256_max_pd(a, b); }
+  static unsigned equal_mask(Reg a, Reg b){ return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+};
+#elif defined(__SSE2__)
+template <> struct Simd<int> {
+  using Reg = __m128i;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 4;
+  static Reg load(const int* p){ return _mm_loadu_si128(reinterpret_cast<const Reg*>(p)); }
+  static void store(int* p, Reg a){ _mm_storeu_si128(reinterpret_cast<Reg*>(p), a); }
+  static Reg broadcast(int x){ return _mm_set1_epi32(x); }
+  static Reg add(Reg a, Reg b){ return _mm_add_epi32(a, b); }
+  // min/max для int32 появились только в SSE4.1, поэтому через сравнение
+  static Reg select(Reg mask, Reg a, Reg b){
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+  }
+  static Reg min(Reg a, Reg b){ return select(_mm_cmplt_epi32(a, b), a, b); }
+  static Reg max(Reg a, Reg b){ return select(_mm_cmpgt_epi32(a, b), a, b); }
+  static unsigned equal_mask(Reg a, Reg b){
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+  }
+};
+
+template <> struct Simd<float> {
+  using Reg = __m128;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 4;
+  static Reg load(const float* p){ return _mm_loadu_ps(p); }
+  static void store(float* p, Reg a){ _mm_storeu_ps(p, a); }
+  static Reg broadcast(float x){ return _mm_set1_ps(x); }
+  static Reg add(Reg a, Reg b){ return _mm_add_ps(a, b); }
+  static Reg min(Reg a, Reg b){ return _mm_min_ps(a, b); }
+  static Reg max(Reg a, Reg b){ return _mm_max_ps(a, b); }
+  static unsigned equal_mask(Reg a, Reg b){ return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+};
+
+template <> struct Simd<double> {
+  using Reg = __m128d;
+  static constexpr bool kEnabled = true;
+  static constexpr std::size_t kWidth = 2;
+  static Reg load(const double* p){ return _mm_loadu_pd(p); }
+  static void store(double* p, Reg a){ _mm_storeu_pd(p, a); }
+  static Reg broadcast(double x){ return _mm_set1_pd(x); }
+  static Reg add(Reg a, Reg b){ return _mm_add_pd(a, b); }
+  static Reg min(Reg a, Reg b){ return _mm_min_pd(a, b); }
+  static Reg max(Reg a, Reg b){ return _mm_max_pd(a, b); }
+  static unsigned equal_mask(Reg a, Reg b){ return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+};
+#endif
+
+// Сумма n элементов. Складывается по kWidth независимых сумм, поэтому для
+// float/double результат может отличаться от последовательной суммы в
+// последних битах
+template <class T> T simd_sum(const T* data, std::size_t n){
+  using S = Simd<T>;
+  T total = 0;
+  std::size_t i = 0;
+  if constexpr (S::kEnabled){
+    auto acc = S::broadcast(0);
+    for(; i + S::kWidth <= n; i += S::kWidth){
+      acc = S::add(acc, S::load(data + i));
+    }
+    T lanes[S::kWidth];
+    S::store(lanes, acc);
+    for(T lane : lanes){
+      total += lane;
+    }
+  }
+  for(; i < n; ++i){
+    total += data[i];
+  }
+  return total;
+}
+
+// Наименьший (Max == false) или наибольший элемент среди n > 0 (без NaN)
+template <bool Max, class T> T simd_extreme(const T* data, std::size_t n){
+  using S = Simd<T>;
+  T best = data[0];
+  std::size_t i = 0;
+  if constexpr (S::kEnabled){
+    auto acc = S::broadcast(best);
+    for(; i + S::kWidth <= n; i += S::kWidth){
+      acc = Max ? S::max(acc, S::load(data + i)) : S::min(acc, S::load(data + i));
+    }
+    T lanes[S::kWidth];
+    S::store(lanes, acc);
+    for(T lane : lanes){
+      best = Max ? std::max(best, lane) : std::min(best, lane);
+    }
+  }
+  for(; i < n; ++i){
+    best = Max ? std::max(best, data[i]) : std::min(best, data[i]);
+  }
+  return best;
+}
+
+// Индекс первого элемента, равного value, или n
+template <class T> std::size_t simd_find(const T* data, std::size_t n, T value){
+  using S = Simd<T>;
+  std::size_t i = 0;
+  if constexpr (S::kEnabled){
+    auto needle = S::broadcast(value);
+    for(; i + S::kWidth <= n; i += S::kWidth){
+      if(unsigned mask = S::equal_mask(S::load(data + i), needle)){
+        return i + __builtin_ctz(mask);
+      }
+    }
+  }
+  for(; i < n && !(data[i] == value); ++i){
+  }
+  return i;
+}
+
+// Сколько элементов равны value
+template <class T> std::size_t simd_count(const T* data, std::size_t n, T value){
+  using S = Simd<T>;
+  std::size_t count = 0, i = 0;
+  if constexpr (S::kEnabled){
+    auto needle = S::broadcast(value);
+    for(; i + S::kWidth <= n; i += S::kWidth){
+      count += __builtin_popcount(S::equal_mask(S::load(data + i), needle));
+    }
+  }
+  for(; i < n; ++i){
+    count += data[i] == value;
+  }
+  return count;
+}
+
+// Меньше стольких элементов на поток не дается: создание потока стоит
+// десятки микросекунд
+constexpr std::size_t kParallelGrain = 1 << 16;
+
+// На сколько кусков делить n элементов при threads потоках
+inline std::size_t parallel_chunk_count(std::size_t n, unsigned threads){
+  return std::max<std::size_t>(1, std::min<std::size_t>(threads, n / kParallelGrain));
+}
+
+// Делит [0, n) на chunks кусков почти равной длины и вызывает
+// work(begin, end, chunk) для каждого: первый кусок в текущем потоке,
+// остальные - каждый в своем. Исключение из work в другом потоке завершает
+// программу, поэтому work не должен бросать.
+template <class Work>
+void parallel_chunks(std::size_t n, std::size_t chunks, Work work){
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  for(std::size_t chunk = 1; chunk < chunks; ++chunk){
+    workers.emplace_back([&work, n, chunks, chunk]{
+      work(n * chunk / chunks, n * (chunk + 1) / chunks, chunk);
+    });
+  }
+  work(0, n / chunks, 0);
+  for(std::thread &worker : workers){
+    worker.join();
+  }
+}
+
+// Встроенный буфер на N элементов внутри самого объекта (для SmallVector)
+template <class T, std::size_t N> struct InlineBuffer {
+  alignas(T) unsigned char bytes[N * sizeof(T)];
+
+  T* inline_data(){
+    return reinterpret_cast<T*>(bytes);
+  }
+};
+
+// У обычного Vector встроенного буфера нет, и он не занимает места
+template <class T> struct InlineBuffer<T, 0> {
+  T* inline_data(){
+    return nullptr;
+  }
+};
+
+// Память под элементы выделяется сырой (std::allocator), а элементы
+// создаются в ней placement-new только когда появляются: за size_ лежит
+// неинициализированная память, а не capacity_ - size_ дефолтных T.
+//
+// С N > 0 первые N элементов помещаются во встроенный буфер, и в кучу
+// вектор уходит только когда их становится больше (см. SmallVector).
+// Емкость встроенного буфера всегда ровно N, а буфера из кучи - больше N.
+template <class T, class Growth = GrowTwice, std::size_t N = 0>
+class Vector : private InlineBuffer<T, N> {
 private:
   size_t size_;
   size_t capacity_;
   T* vector;
 
+  // int, double, POD-структуры: копирование, перенос и сдвиг элементов -
+  // это просто копирование байт, а разрушать их не нужно
+  static constexpr bool kTrivial = std::is_trivially_copyable<T>::value;
+
+  // Перемещение вектора не бросает: буфер из кучи просто забирается, а
+  // встроенные элементы перемещаются без исключений
+  static constexpr bool kNothrowMove = N == 0 || std::is_nothrow_move_constructible<T>::value;
+
+  // memcpy для n элементов; n == 0 допускает nullptr
+  static void copy_bytes(const T* from, std::size_t n, T* to){
+    if(n){
+      std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+    }
+  }
+
+  // Сдвигает n элементов с from на место to (участки могут пересекаться)
+  static void move_bytes(const T* from, std::size_t n, T* to){
+    if(n){
+      std::memmove(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+    }
+  }
+
+  // Буфер под n элементов. Если они помещаются во встроенный буфер, то
+  // возвращается он, а n становится равным N
+  T* allocate(std::size_t &n){
+    if(n <= N){
+      n = N;
+      return this->inline_data();
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  static void deallocate(T* data, std::size_t n){
+    if(n > N){
+      std::allocator<T>().deallocate(data, n);
+    }
+  }
+
+  // Переносит n элементов из from в сырую память to. Перемещает, если
+  // перемещение T не бросает исключений (или T нельзя копировать), иначе
+  // копирует: тогда при исключении старый буфер останется целым.
+  static void relocate(T* from, std::size_t n, T* to){
+    if constexpr (kTrivial){
+      copy_bytes(from, n, to);
+    }
+    else if constexpr (std::is_nothrow_move_constructible<T>::value ||
+                       !std::is_copy_constructible<T>::value){
+      std::uninitialized_move(from, from + n, to);
+    }
+    else{
+      std::uninitialized_copy(from, from + n, to);
+    }
+  }
+
+  template <class It>
+  using RequireIterator = std::enable_if_t<std::is_base_of<
+      std::input_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value>;
+
+  // Итератор можно пройти дважды, поэтому число элементов известно заранее
+  template <class It>
+  static constexpr bool kForward = std::is_base_of<
+      std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value;
+
+  // first указывает внутрь самого вектора, например v.insert(0, v.begin() + 2, v.begin() + 5)
+  template <class It>
+  bool points_inside(It first) const {
+    if constexpr (std::is_convertible<It, const T*>::value){
+      std::less<const T*> less;
+      return !less(first, vector) && less(first, vector + size_);
+    }
+    return false;
+  }
+
+  // Вставляет n элементов из first на место pos. Если памяти не хватает, то
+  // новые элементы создаются сразу в новом буфере, а старые переезжают
+  // вокруг них, иначе хвост сдвигается на n один раз. [first, first + n)
+  // может быть частью самого вектора.
+  template <class It>
+  void insert_n(std::size_t pos, It first, std::size_t n){
+    if(n == 0){
+      return;
+    }
+    if(size_ + n > capacity_){
+      std::size_t new_capacity = Growth::grow(capacity_, size_ + n, sizeof(T));
+      T* tmp = allocate(new_capacity);
+      try{
+        std::uninitialized_copy_n(first, n, tmp + pos);
+      }
+      catch(...){
+        deallocate(tmp, new_capacity);
+        throw;
+      }
+      try{
+        relocate(vector, pos, tmp);
+        try{
+          relocate(vector + pos, size_ - pos, tmp + pos + n);
+        }
+        catch(...){
+          std::destroy(tmp, tmp + pos);
+          throw;
+        }
+      }
+      catch(...){
+        std::destroy(tmp + pos, tmp + pos + n);
+        deallocate(tmp, new_capacity);
+        throw;
+      }
+      std::destroy(vector, vector + size_);
+      deallocate(vector, capacity_);
+      vector = tmp;
+      capacity_ = new_capacity;
+    }
+    else if constexpr (kTrivial){
+      if(points_inside(first)){
+        // сдвиг хвоста затер бы еще не скопированный источник, поэтому как
+        // для остальных T: дописываем в конец и поворачиваем
+        std::uninitialized_copy_n(first, n, vector + size_);
+        std::rotate(vector + pos, vector + size_, vector + size_ + n);
+      }
+      else{
+        move_bytes(vector + pos, size_ - pos, vector + pos + n);
+        std::uninitialized_copy_n(first, n, vector + pos);
+      }
+    }
+    else{
+      // дописываем в конец и одним поворотом ставим на место
+      std::uninitialized_copy_n(first, n, vector + size_);
+      std::rotate(vector + pos, vector + size_, vector + size_ + n);
+    }
+    size_ += n;
+  }
+
+  // Растит емкость по политике Growth, если required не помещается
+  void grow_to(std::size_t required){
+    if(required > capacity_){
+      reallocate(Growth::grow(capacity_, required, sizeof(T)));
+    }
+  }
+
+  // Забирает элементы other в пустой вектор со встроенным буфером. Буфер из
+  // кучи забирается целиком, а встроенные элементы переносятся по одному
+  void take(Vector &other){
+    if(other.capacity_ > N){
+      vector = other.vector;
+      capacity_ = other.capacity_;
+      other.vector = other.inline_data();
+      other.capacity_ = N;
+    }
+    else{
+      relocate(other.vector, other.size_, vector);
+      std::destroy(other.vector, other.vector + other.size_);
+    }
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+
+  // min/max: каждый кусок дает свой экстремум, из них выбирается общий
+  template <bool Max>
+  T extreme(unsigned threads) const{
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    std::vector<std::optional<T>> partial(chunks);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk){
+      if constexpr (Simd<T>::kEnabled){
+        partial[chunk] = simd_extreme<Max>(vector + begin, end - begin);
+      }
+      else{
+        partial[chunk] = Max ? *std::max_element(vector + begin, vector + end)
+                             : *std::min_element(vector + begin, vector + end);
+      }
+    });
+    T best = std::move(*partial[0]);
+    for(std::size_t chunk = 1; chunk < chunks; ++chunk){
+      if(Max ? best < *partial[chunk] : *partial[chunk] < best){
+        best = std::move(*partial[chunk]);
+      }
+    }
+    return best;
+  }
+
+  // Переезд в новый буфер на new_capacity элементов (не меньше size_)
+  void reallocate(std::size_t new_capacity){
+    T* tmp = allocate(new_capacity);
+    try{
+      relocate(vector, size_, tmp);
+    }
+    catch(...){
+      deallocate(tmp, new_capacity);
+      throw;
+    }
+    std::destroy(vector, vector + size_);
+    deallocate(vector, capacity_);
+    vector = tmp;
+    capacity_ = new_capacity;
+  }
+
 public:
-  // Создает вектор размера arr_size заполненный дефолтными значениями типа T
-  Vector(std::size_t arr_size = 0):size_(arr_size),capacity_(arr_size*2+1),vector(new T[capacity_]{}){};
+  // Элементы лежат в памяти подряд, поэтому итераторы - обычные указатели:
+  // std::sort(v.begin(), v.end()), std::copy и memcpy(v.data()) работают
+  // прямо с буфером вектора
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-  Vector(int* arr, size_t arr_size):Vector(arr_size)
-  {
-    for(int i=0; i<size_; ++i){
-      vector[i]=arr[i];
+  // Создает вектор размера arr_size заполненный дефолтными значениями типа T.
+  // Памяти выделяется ровно под arr_size элементов
+  Vector(std::size_t arr_size = 0):size_(0),capacity_(arr_size),vector(allocate(capacity_)){
+    try{
+      std::uninitialized_value_construct(vector, vector + arr_size);
     }
+    catch(...){
+      deallocate(vector, capacity_);
+      throw;
+    }
+    size_ = arr_size;
+  };
+
+  // Копирует arr_size элементов из массива arr
+  Vector(const T* arr, size_t arr_size):Vector(arr, arr + arr_size){};
+
+  // Создает вектор из диапазона [first, last) любых итераторов
+  template <class It, class = RequireIterator<It>>
+  Vector(It first, It last):size_(0),capacity_(0),vector(allocate(capacity_))
+  {
+    append(first, last);
   };
 
   // Создает новый вектор, являющийся глубокой копией вектора other
-  Vector(const Vector &other):size_(other.size),capacity_(other.capacity),vector(new T[other.capacity_]){
-    for (size_t i = 0; i < other.size_; ++i) 
-    {
-      vector[i] = other.vector[i];
+  Vector(const Vector &other):size_(0),capacity_(other.capacity_),vector(allocate(capacity_)){
+    try{
+      if constexpr (kTrivial){
+        copy_bytes(other.vector, other.size_, vector);
+      }
+      else{
+        std::uninitialized_copy(other.vector, other.vector + other.size_, vector);
+      }
     }
-    //Vector<T> vector = other;
+    catch(...){
+      deallocate(vector, capacity_);
+      throw;
+    }
+    size_ = other.size_;
+  };
+
+  // Забирает буфер other, other остается пустым. Элементы из встроенного
+  // буфера other перемещаются по одному
+  Vector(Vector &&other) noexcept(kNothrowMove)
+      :size_(0),capacity_(N),vector(this->inline_data()){
+    take(other);
   };
 
   // Перезаписывает текущий вектор вектором other
@@ -32,41 +566,124 @@ public:
   // std::cout << v1.size() == 10 << std::endl // True
   Vector &operator=(const Vector &other)
   {
-    delete[] vector;
-    vector = new T[other.capacity_];
-      
-    for (size_t i = 0; i < other.size_; ++i) 
-    {
-      vector[i] = other.vector[i];
+    if(this != &other){
+      Vector tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  };
+
+  Vector &operator=(Vector &&other) noexcept(kNothrowMove)
+  {
+    if(this != &other){
+      std::destroy(vector, vector + size_);
+      deallocate(vector, capacity_);
+      size_ = 0;
+      capacity_ = N;
+      vector = this->inline_data();
+      take(other);
     }
-      
-    size_ = other.size_;
-    capacity_ = other.capacity_;
     return *this;
   };
 
   // Очищает память вектора
   ~Vector(){
-    delete[] vector;
+    std::destroy(vector, vector + size_);
+    deallocate(vector, capacity_);
+  };
+
+  void swap(Vector &other) noexcept(kNothrowMove){
+    if constexpr (N == 0){
+      std::swap(size_, other.size_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(vector, other.vector);
+    }
+    else{
+      // встроенные буферы обменять указателями нельзя
+      Vector tmp(std::move(other));
+      other = std::move(*this);
+      *this = std::move(tmp);
+    }
   };
 
   // Возвращает размер вектора (сколько памяти уже занято)
-  std::size_t size(){
+  std::size_t size() const{
     return size_;
   };
 
   // Проверяет является ли контейнер пустым
-  bool empty(){
+  bool empty() const{
     return size_ == 0;
   };
 
   // Возвращает размер выделенной памяти
-  std::size_t capacity(){
+  std::size_t capacity() const{
     return capacity_;
   };
 
-  // Возвращает копию элемента по индексу
-  T operator[](std::size_t index) const{
+  // Указатель на первый элемент (у пустого вектора может быть nullptr)
+  T* data(){
+    return vector;
+  };
+
+  const T* data() const{
+    return vector;
+  };
+
+  iterator begin(){
+    return vector;
+  };
+
+  iterator end(){
+    return vector + size_;
+  };
+
+  const_iterator begin() const{
+    return vector;
+  };
+
+  const_iterator end() const{
+    return vector + size_;
+  };
+
+  const_iterator cbegin() const{
+    return vector;
+  };
+
+  const_iterator cend() const{
+    return vector + size_;
+  };
+
+  reverse_iterator rbegin(){
+    return reverse_iterator(end());
+  };
+
+  reverse_iterator rend(){
+    return reverse_iterator(begin());
+  };
+
+  const_reverse_iterator rbegin() const{
+    return const_reverse_iterator(end());
+  };
+
+  const_reverse_iterator rend() const{
+    return const_reverse_iterator(begin());
+  };
+
+#if __cplusplus >= 202002L
+  // Элементы вектора как std::span без копирования. Span указывает в буфер
+  // и становится недействительным после переезда вектора (push_back, reserve)
+  std::span<T> span(){
+    return std::span<T>(vector, size_);
+  };
+
+  std::span<const T> span() const{
+    return std::span<const T>(vector, size_);
+  };
+#endif
+
+  // Возвращает константную ссылку на элемент по индексу
+  const T &operator[](std::size_t index) const{
     return vector[index];
   };
 
@@ -76,78 +693,1601 @@ public:
     return vector[index];
   };
 
-  // Перевыделяет память:
-  // * выделяет новый кусок памяти размером равным new_capacity,
-  // * копирует столько старых элементов, сколько влезает,
-  // * удаляет старый кусок памяти.
-  void resize(std::size_t new_capacity){
-    if(new_capacity<capacity_)
+  // Выделяет память хотя бы под new_capacity элементов, сами элементы не
+  // создаются. Если памяти уже хватает, ничего не делает
+  void reserve(std::size_t new_capacity){
+    if(new_capacity > capacity_){
+      reallocate(Growth::fit(new_capacity, sizeof(T)));
+    }
+  };
+
+  // Меняет размер: лишние элементы удаляются, новые создаются как T{}.
+  // Емкость растет по политике Growth, а при уменьшении не меняется
+  void resize(std::size_t new_size){
+    if(new_size <= size_){
+      std::destroy(vector + new_size, vector + size_);
+    }
+    else{
+      grow_to(new_size);
+      std::uninitialized_value_construct(vector + size_, vector + new_size);
+    }
+    size_ = new_size;
+  };
+
+  // То же, но новые элементы - копии value
+  void resize(std::size_t new_size, const T &value){
+    if(new_size <= size_){
+      std::destroy(vector + new_size, vector + size_);
+    }
+    else if(new_size > capacity_){
+      // value может лежать в этом же векторе, копируем до переезда
+      T copy(value);
+      grow_to(new_size);
+      std::uninitialized_fill(vector + size_, vector + new_size, copy);
+    }
+    else{
+      std::uninitialized_fill(vector + size_, vector + new_size, value);
+    }
+    size_ = new_size;
+  };
+
+  // Отдает неиспользуемую память: емкость становится равной размеру (у
+  // SmallVector - не меньше N, элементы возвращаются во встроенный буфер)
+  void shrink_to_fit(){
+    if(capacity_ > size_ && capacity_ > N){
+      reallocate(size_);
+    }
+  };
+
+  // Создает элемент из args прямо в конце вектора и возвращает ссылку на
+  // него. Если нужно перевыделяет память: новый элемент создается в новом
+  // буфере до переезда старых, так что args могут ссылаться на элементы
+  // этого же вектора (v.emplace_back(v[0])).
+  template <class... Args>
+  T &emplace_back(Args&&... args){
+    if (size_ < capacity_)
     {
-      size_ = new_capacity;
+      ::new (static_cast<void*>(vector + size_)) T(std::forward<Args>(args)...);
+      return vector[size_++];
+    }
+    std::size_t new_capacity = Growth::grow(capacity_, size_ + 1, sizeof(T));
+    T* tmp = allocate(new_capacity);
+    try{
+      ::new (static_cast<void*>(tmp + size_)) T(std::forward<Args>(args)...);
+    }
+    catch(...){
+      deallocate(tmp, new_capacity);
+      throw;
     }
+    try{
+      relocate(vector, size_, tmp);
+    }
+    catch(...){
+      tmp[size_].~T();
+      deallocate(tmp, new_capacity);
+      throw;
+    }
+    std::destroy(vector, vector + size_);
+    deallocate(vector, capacity_);
+    vector = tmp;
     capacity_ = new_capacity;
-    T* tmp = vector;
-    vector = new T[capacity_];
-    for (size_t i = 0; i < size_; ++i)
-    {
-      vector[i] = tmp[i];
-    } 
-    delete[] tmp;
+    return vector[size_++];
   };
 
   // Добавляет элемент в конец вектора. Если нужно перевыделяет память
   void push_back(const T &x){
-    if (size_ >= capacity_)
-    {
-      resize(capacity_*2);
-    }
-    vector[size_++] = x;
+    emplace_back(x);
+  };
+
+  // То же, но x перемещается в вектор
+  void push_back(T &&x){
+    emplace_back(std::move(x));
   };
 
   // Удаляет последний элемент вектора и возвращает его.
   T pop_back(){
-    T tmp = vector[size_-1];
-    size_--;
+    T tmp = std::move(vector[size_-1]);
+    vector[--size_].~T();
     return tmp;
   };
 
   // Очищает вектор (выделенная память остает выделенной)
   void clear(){
+    std::destroy(vector, vector + size_);
     size_=0;
   };
 
-  // Вставляет новый элемент value на место pos.
+  // Вставляет новый элемент value на место pos. Хвост сдвигается одним
+  // memmove для тривиально копируемых T, иначе перемещением.
   // [1, 2, 3].insert(1, 42) -> [1, 42, 2, 3]
   void insert(size_t pos, T value){
-    push_back(value);
-    for(size_t i=size_-1; i>pos; --i)
-      {
-        std::swap(vector[i],vector[i-1]);
+    if(pos == size_){
+      emplace_back(std::move(value));
+      return;
+    }
+    grow_to(size_ + 1);
+    if constexpr (kTrivial){
+      move_bytes(vector + pos, size_ - pos, vector + pos + 1);
+      ::new (static_cast<void*>(vector + pos)) T(std::move(value));
+    }
+    else{
+      ::new (static_cast<void*>(vector + size_)) T(std::move(vector[size_ - 1]));
+      std::move_backward(vector + pos, vector + size_ - 1, vector + size_);
+      vector[pos] = std::move(value);
+    }
+    ++size_;
+  };
+
+  // Вставляет элементы [first, last) на место pos за O(size - pos + k):
+  // память выделяется не больше одного раза, хвост сдвигается один раз.
+  // [1, 2, 3].insert(1, {7, 8}) -> [1, 7, 8, 2, 3]
+  template <class It, class = RequireIterator<It>>
+  void insert(size_t pos, It first, It last){
+    if constexpr (kForward<It>){
+      insert_n(pos, first, std::distance(first, last));
+    }
+    else{
+      // однопроходный итератор: дописываем по одному, потом поворачиваем
+      std::size_t old_size = size_;
+      for(; first != last; ++first){
+        emplace_back(*first);
+      }
+      std::rotate(vector + pos, vector + old_size, vector + size_);
+    }
+  };
+
+  // Дописывает элементы [first, last) в конец
+  template <class It, class = RequireIterator<It>>
+  void append(It first, It last){
+    insert(size_, first, last);
+  };
+
+  // Заменяет содержимое элементами [first, last)
+  template <class It, class = RequireIterator<It>>
+  void assign(It first, It last){
+    clear();
+    if constexpr (kForward<It>){
+      reserve(std::distance(first, last));
+    }
+    append(first, last);
+  };
+
+  // Удаляет элементы с индексами [first, last), хвост сдвигается один раз
+  void erase(size_t first, size_t last)
+  {
+    if(first == last){
+      return;
+    }
+    if constexpr (kTrivial){
+      move_bytes(vector + last, size_ - last, vector + first);
+    }
+    else{
+      std::move(vector + last, vector + size_, vector + first);
+      std::destroy(vector + size_ - (last - first), vector + size_);
+    }
+    size_ -= last - first;
+  };
+
+  // Алгоритмы над всеми элементами. Для int, float и double суммирование,
+  // поиск и min/max идут SIMD-ядрами (см. Simd), остальные типы и операции -
+  // обычным циклом. Вектор от 2 * kParallelGrain элементов делится на куски
+  // и обрабатывается в threads потоках, так что op, f, less и pred
+  // вызываются одновременно из нескольких потоков.
+
+  // Сворачивает элементы операцией op, начиная с init. Куски сворачиваются
+  // независимо, поэтому op должна быть ассоциативной (как в std::reduce).
+  // Результат и промежуточные значения имеют тип U, он не выводится из init:
+  // v.reduce() - сумма элементов, v.reduce<long long>() - сумма int без
+  // переполнения (уже без SIMD-ядра)
+  template <class U = T, class Op = std::plus<>>
+  U reduce(std::common_type_t<U> init = U{}, Op op = Op{},
+           unsigned threads = std::thread::hardware_concurrency()) const{
+    constexpr bool kSum = std::is_same<Op, std::plus<>>::value || std::is_same<Op, std::plus<T>>::value;
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    std::vector<std::optional<U>> partial(chunks);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk){
+      if(begin == end){
+        return;
+      }
+      if constexpr (kSum && Simd<T>::kEnabled && std::is_same<U, T>::value){
+        partial[chunk] = simd_sum(vector + begin, end - begin);
+      }
+      else{
+        U acc = vector[begin];
+        for(std::size_t i = begin + 1; i < end; ++i){
+          acc = op(std::move(acc), vector[i]);
+        }
+        partial[chunk] = std::move(acc);
+      }
+    });
+    for(std::optional<U> &value : partial){
+      if(value){
+        init = op(std::move(init), std::move(*value));
+      }
+    }
+    return init;
+  };
+
+  // Заменяет каждый элемент на f(элемент). Цикл без зависимостей между
+  // итерациями компилятор векторизует сам
+  template <class F>
+  void transform(F f, unsigned threads = std::thread::hardware_concurrency()){
+    parallel_chunks(size_, parallel_chunk_count(size_, threads),
+                    [&](std::size_t begin, std::size_t end, std::size_t){
+      for(std::size_t i = begin; i < end; ++i){
+        vector[i] = f(vector[i]);
+      }
+    });
+  };
+
+  // Индекс первого элемента, равного value, или size(), если такого нет
+  std::size_t find(const T &value, unsigned threads = std::thread::hardware_concurrency()) const{
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    std::vector<std::size_t> found(chunks, size_);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk){
+      std::size_t index;
+      if constexpr (Simd<T>::kEnabled){
+        index = begin + simd_find(vector + begin, end - begin, value);
+      }
+      else{
+        index = std::find(vector + begin, vector + end, value) - vector;
       }
+      if(index != end){
+        found[chunk] = index;
+      }
+    });
+    return *std::min_element(found.begin(), found.end());
+  };
+
+  // Сколько элементов равны value
+  std::size_t count(const T &value, unsigned threads = std::thread::hardware_concurrency()) const{
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    std::vector<std::size_t> counts(chunks);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk){
+      if constexpr (Simd<T>::kEnabled){
+        counts[chunk] = simd_count(vector + begin, end - begin, value);
+      }
+      else{
+        counts[chunk] = std::count(vector + begin, vector + end, value);
+      }
+    });
+    return std::accumulate(counts.begin(), counts.end(), std::size_t(0));
+  };
+
+  // Наименьший элемент непустого вектора
+  T min(unsigned threads = std::thread::hardware_concurrency()) const{
+    return extreme<false>(threads);
+  };
+
+  // Наибольший элемент непустого вектора
+  T max(unsigned threads = std::thread::hardware_concurrency()) const{
+    return extreme<true>(threads);
+  };
+
+  // Сортирует по less (не устойчиво). В параллельном режиме куски
+  // сортируются каждый в своем потоке, а потом попарно сливаются, тоже
+  // параллельно: log(число потоков) раундов слияния
+  template <class Less = std::less<>>
+  void sort(Less less = Less{}, unsigned threads = std::thread::hardware_concurrency()){
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t){
+      std::sort(vector + begin, vector + end, less);
+    });
+    auto bound = [&](std::size_t chunk){
+      return vector + size_ * std::min(chunk, chunks) / chunks;
+    };
+    for(std::size_t step = 1; step < chunks; step *= 2){
+      std::size_t merges = (chunks + 2 * step - 1) / (2 * step);
+      parallel_chunks(merges, merges, [&](std::size_t merge, std::size_t, std::size_t){
+        std::size_t first = merge * 2 * step;
+        std::inplace_merge(bound(first), bound(first + step), bound(first + 2 * step), less);
+      });
+    }
+  };
+
+  // Переставляет элементы, для которых pred истинен, в начало (не
+  // устойчиво) и возвращает их число. Куски разбиваются параллельно, потом
+  // их истинные части сдвигаются к началу поворотами
+  template <class Pred>
+  std::size_t partition(Pred pred, unsigned threads = std::thread::hardware_concurrency()){
+    std::size_t chunks = parallel_chunk_count(size_, threads);
+    std::vector<std::size_t> middle(chunks);
+    parallel_chunks(size_, chunks, [&](std::size_t begin, std::size_t end, std::size_t chunk){
+      middle[chunk] = std::partition(vector + begin, vector + end, pred) - vector;
+    });
+    std::size_t boundary = middle[0];
+    for(std::size_t chunk = 1; chunk < chunks; ++chunk){
+      std::size_t begin = size_ * chunk / chunks;
+      std::rotate(vector + boundary, vector + begin, vector + middle[chunk]);
+      boundary += middle[chunk] - begin;
+    }
+    return boundary;
   };
 
   // Удаляет элемент с идексом pos. Возвращает удаленный элемент.
   // [1, 2, 3].erase(1) -> [1, 3] (return 2)
   T erase(size_t pos)
   {
-    T tmp = vector[pos];
-    for (size_t i = pos + 1; i < size_; ++i) {
-    		vector[i - 1] = vector[i];
+    T tmp = std::move(vector[pos]);
+    if constexpr (kTrivial){
+      move_bytes(vector + pos + 1, size_ - pos - 1, vector + pos);
+      --size_;
+    }
+    else{
+      std::move(vector + pos + 1, vector + size_, vector + pos);
+      vector[--size_].~T();
     }
-    --size_;
     return tmp;
   };
 };
-template <class T>
-std::ostream& operator<<(std::ostream &out, Vector<T> &instance){
-  for(int i=0; i<instance.size(); ++i){
-    out << instance[i] << " ";
+
+// Вектор, который хранит до N элементов в самом объекте и выделяет память в
+// куче, только когда элементов становится больше. Для множества коротких
+// векторов (локальные списки, ребра вершины графа) это убирает malloc/free.
+// SmallVector<int, 8> v; v.push_back(1); // без выделения памяти
+template <class T, std::size_t N, class Growth = GrowTwice>
+using SmallVector = Vector<T, Growth, N>;
+
+template <class T, class Growth, std::size_t N>
+std::ostream& operator<<(std::ostream &out, const Vector<T, Growth, N> &instance){
+  for(const T &item : instance){
+    out << item << " ";
   }
   return out;
 };
 
-int main() 
-{
+// Вектор в файле: элементы лежат в отображенном в память (mmap) файле, а не
+// в куче. Открытие существующего файла ничего не читает - страницы
+// подгружаются ОС при первом обращении, поэтому перезапуск с гигабайтным
+// массивом почти мгновенный. Файл растет через ftruncate + mremap по той же
+// политике Growth, что и Vector. Подходит только для тривиально копируемых T:
+// элементы сохраняются в файл байтами как есть.
+//
+// Формат файла: заголовок kHeaderBytes байт (метка, sizeof(T), число
+// элементов), за ним capacity() элементов. Число элементов записывается в
+// заголовок в sync() и деструкторе; изменения, не прошедшие через sync(),
+// могут не пережить падение системы.
+//
+// MappedVector<Record> records("records.bin");
+// records.push_back(record);
+// records.sync();
+template <class T, class Growth = GrowTwice> class MappedVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "elements are stored in the file as raw bytes");
+
+public:
+  enum class Mode {
+    ReadWrite, // файл создается, если его нет
+    ReadOnly,  // файл должен существовать; несколько процессов делят одни
+               // и те же страницы в кэше ОС
+  };
+
+  // Подсказка ОС о порядке чтения (madvise)
+  enum class Access { Normal, Sequential, Random, WillNeed };
+
+  static constexpr std::size_t kHeaderBytes = 64;
+  static_assert(alignof(T) <= kHeaderBytes, "elements must stay aligned after the header");
+
+private:
+  struct Header {
+    char magic[8];
+    std::uint64_t record_size;
+    std::uint64_t size;
+  };
+  static constexpr char kMagic[8] = {'M', 'V', 'E', 'C', 'T', 'O', 'R', '1'};
+
+  int fd = -1;
+  char* base = nullptr; // начало отображения (заголовок)
+  std::size_t mapped = 0;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = 0;
+  bool writable = false;
+
+  [[noreturn]] static void throw_errno(const std::string &what){
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  Header* header() const{
+    return reinterpret_cast<Header*>(base);
+  }
+
+  T* elements() const{
+    return reinterpret_cast<T*>(base + kHeaderBytes);
+  }
+
+  static std::size_t file_bytes(std::size_t capacity){
+    return kHeaderBytes + capacity * sizeof(T);
+  }
+
+  void require_writable() const{
+    if(!writable){
+      throw std::logic_error("MappedVector is opened read-only");
+    }
+  }
+
+  // Перемещает отображение на bytes байт (файл уже нужной длины)
+  void remap(std::size_t bytes){
+#if defined(__linux__)
+    void* moved = ::mremap(base, mapped, bytes, MREMAP_MAYMOVE);
+    if(moved == MAP_FAILED){
+      throw_errno("mremap");
+    }
+#else
+    void* moved = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(moved == MAP_FAILED){
+      throw_errno("mmap");
+    }
+    ::munmap(base, mapped);
+#endif
+    base = static_cast<char*>(moved);
+    mapped = bytes;
+  }
+
+  // Меняет емкость (не меньше size_): при росте сначала удлиняется файл,
+  // при уменьшении сначала сжимается отображение, чтобы за концом файла не
+  // оставалось отображенных страниц
+  void reallocate(std::size_t new_capacity){
+    require_writable();
+    std::size_t bytes = file_bytes(new_capacity);
+    if(new_capacity > capacity_){
+      if(::ftruncate(fd, bytes) != 0){
+        throw_errno("ftruncate");
+      }
+      remap(bytes);
+    }
+    else{
+      remap(bytes);
+      if(::ftruncate(fd, bytes) != 0){
+        throw_errno("ftruncate");
+      }
+    }
+    capacity_ = new_capacity;
+  }
+
+  void grow_to(std::size_t required){
+    require_writable();
+    if(required > capacity_){
+      reallocate(Growth::grow(capacity_, required, sizeof(T)));
+    }
+  }
+
+  void close(){
+    if(base){
+      if(writable){
+        header()->size = size_;
+      }
+      ::munmap(base, mapped);
+      base = nullptr;
+    }
+    if(fd >= 0){
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  // Открывает (или создает) файл path. Бросает std::system_error, если
+  // файл не открывается, и std::runtime_error, если в нем не MappedVector<T>
+  explicit MappedVector(const std::string &path, Mode mode = Mode::ReadWrite)
+      :writable(mode == Mode::ReadWrite){
+    try{
+      fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+      if(fd < 0){
+        throw_errno("open " + path);
+      }
+      struct stat info;
+      if(::fstat(fd, &info) != 0){
+        throw_errno("fstat " + path);
+      }
+      std::size_t bytes = info.st_size;
+      bool created = bytes == 0 && writable;
+      if(created){
+        bytes = kHeaderBytes;
+        if(::ftruncate(fd, bytes) != 0){
+          throw_errno("ftruncate " + path);
+        }
+      }
+      if(bytes < kHeaderBytes){
+        throw std::runtime_error(path + ": not a MappedVector file");
+      }
+      int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+      void* mapping = ::mmap(nullptr, bytes, protection, MAP_SHARED, fd, 0);
+      if(mapping == MAP_FAILED){
+        throw_errno("mmap " + path);
+      }
+      base = static_cast<char*>(mapping);
+      mapped = bytes;
+      if(created){
+        std::memcpy(header()->magic, kMagic, sizeof(kMagic));
+        header()->record_size = sizeof(T);
+        header()->size = 0;
+      }
+      if(std::memcmp(header()->magic, kMagic, sizeof(kMagic)) != 0){
+        throw std::runtime_error(path + ": not a MappedVector file");
+      }
+      if(header()->record_size != sizeof(T)){
+        throw std::runtime_error(path + ": record size does not match");
+      }
+      capacity_ = (bytes - kHeaderBytes) / sizeof(T);
+      size_ = header()->size;
+      if(size_ > capacity_){
+        throw std::runtime_error(path + ": file is truncated");
+      }
+    }
+    catch(...){
+      writable = false; // заголовок испорченного файла не трогаем
+      close();
+      throw;
+    }
+  };
+
+  // Файл принадлежит одному объекту, копировать его нельзя
+  MappedVector(const MappedVector &) = delete;
+  MappedVector &operator=(const MappedVector &) = delete;
+
+  MappedVector(MappedVector &&other) noexcept{
+    swap(other);
+  };
+
+  MappedVector &operator=(MappedVector &&other) noexcept{
+    MappedVector tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  };
+
+  // Записывает размер в заголовок и закрывает файл. Данные на диск не
+  // сбрасываются - это делает ОС в фоне или sync()
+  ~MappedVector(){
+    close();
+  };
+
+  void swap(MappedVector &other) noexcept{
+    std::swap(fd, other.fd);
+    std::swap(base, other.base);
+    std::swap(mapped, other.mapped);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(writable, other.writable);
+  };
+
+  // Записывает размер в заголовок и сбрасывает изменения на диск (msync).
+  // С wait == false запись только запускается (MS_ASYNC)
+  void sync(bool wait = true){
+    if(!writable){
+      return;
+    }
+    header()->size = size_;
+    if(::msync(base, mapped, wait ? MS_SYNC : MS_ASYNC) != 0){
+      throw_errno("msync");
+    }
+  };
+
+  // Подсказывает ОС, как будут читаться элементы: Sequential - читать
+  // вперед крупными блоками, Random - не читать лишнего, WillNeed - начать
+  // подгружать файл сразу
+  void advise(Access access) const{
+    int advice = MADV_NORMAL;
+    switch(access){
+      case Access::Normal: advice = MADV_NORMAL; break;
+      case Access::Sequential: advice = MADV_SEQUENTIAL; break;
+      case Access::Random: advice = MADV_RANDOM; break;
+      case Access::WillNeed: advice = MADV_WILLNEED; break;
+    }
+    if(::madvise(base, mapped, advice) != 0){
+      throw_errno("madvise");
+    }
+  };
+
+  std::size_t size() const{
+    return size_;
+  };
+
+  bool empty() const{
+    return size_ == 0;
+  };
+
+  // Сколько элементов помещается в файл без его удлинения
+  std::size_t capacity() const{
+    return capacity_;
+  };
+
+  T* data(){
+    return elements();
+  };
+
+  const T* data() const{
+    return elements();
+  };
+
+  iterator begin(){
+    return elements();
+  };
+
+  iterator end(){
+    return elements() + size_;
+  };
+
+  const_iterator begin() const{
+    return elements();
+  };
+
+  const_iterator end() const{
+    return elements() + size_;
+  };
+
+  const_iterator cbegin() const{
+    return elements();
+  };
+
+  const_iterator cend() const{
+    return elements() + size_;
+  };
+
+  // В файле, открытом ReadOnly, элементы менять нельзя: страницы
+  // отображены только для чтения
+  T &operator[](std::size_t index){
+    return elements()[index];
+  };
+
+  const T &operator[](std::size_t index) const{
+    return elements()[index];
+  };
+
+  // Удлиняет файл хотя бы под new_capacity элементов
+  void reserve(std::size_t new_capacity){
+    if(new_capacity > capacity_){
+      reallocate(Growth::fit(new_capacity, sizeof(T)));
+    }
+  };
+
+  // Меняет размер, новые элементы - T{}
+  void resize(std::size_t new_size){
+    resize(new_size, T{});
+  };
+
+  void resize(std::size_t new_size, const T &value){
+    T copy(value);
+    grow_to(new_size);
+    std::uninitialized_fill(elements() + std::min(size_, new_size), elements() + new_size, copy);
+    size_ = new_size;
+  };
+
+  // Укорачивает файл до size() элементов
+  void shrink_to_fit(){
+    if(capacity_ > size_){
+      reallocate(size_);
+    }
+  };
+
+  // Значение создается до возможного переезда отображения, так что args
+  // могут ссылаться на элементы этого же вектора
+  template <class... Args>
+  T &emplace_back(Args&&... args){
+    T value(std::forward<Args>(args)...);
+    grow_to(size_ + 1);
+    ::new (static_cast<void*>(elements() + size_)) T(value);
+    return elements()[size_++];
+  };
+
+  void push_back(const T &x){
+    emplace_back(x);
+  };
+
+  // Удаляет последний элемент и возвращает его
+  T pop_back(){
+    require_writable();
+    return elements()[--size_];
+  };
+
+  // Удаляет все элементы, длина файла не меняется
+  void clear(){
+    require_writable();
+    size_ = 0;
+  };
+
+  // Вставляет value на место pos, хвост сдвигается одним memmove
+  void insert(std::size_t pos, const T &value){
+    T copy(value);
+    grow_to(size_ + 1);
+    std::memmove(static_cast<void*>(elements() + pos + 1), elements() + pos, (size_ - pos) * sizeof(T));
+    elements()[pos] = copy;
+    ++size_;
+  };
+
+  // Дописывает элементы [first, last) в конец
+  template <class It>
+  void append(It first, It last){
+    if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                  typename std::iterator_traits<It>::iterator_category>::value){
+      grow_to(size_ + std::distance(first, last));
+      size_ = std::uninitialized_copy(first, last, elements() + size_) - elements();
+    }
+    else{
+      for(; first != last; ++first){
+        emplace_back(*first);
+      }
+    }
+  };
+
+  // Удаляет элементы с индексами [first, last)
+  void erase(std::size_t first, std::size_t last){
+    require_writable();
+    std::memmove(static_cast<void*>(elements() + first), elements() + last, (size_ - last) * sizeof(T));
+    size_ -= last - first;
+  };
+
+  // Удаляет элемент с индексом pos и возвращает его
+  T erase(std::size_t pos){
+    T tmp = elements()[pos];
+    erase(pos, pos + 1);
+    return tmp;
+  };
+};
+
+template <class T, class Growth>
+std::ostream& operator<<(std::ostream &out, const MappedVector<T, Growth> &instance){
+  for(const T &item : instance){
+    out << item << " ";
+  }
+  return out;
+};
+
+// Считает копирования и перемещения
+struct MoveCounter {
+  static inline int copies = 0;
+  static inline int moves = 0;
+  int value = 0;
+
+  MoveCounter(int value_ = 0):value(value_){}
+  MoveCounter(const MoveCounter &other):value(other.value){ ++copies; }
+  MoveCounter(MoveCounter &&other) noexcept:value(other.value){ ++moves; }
+  MoveCounter &operator=(const MoveCounter &other){ value = other.value; ++copies; return *this; }
+  MoveCounter &operator=(MoveCounter &&other) noexcept{ value = other.value; ++moves; return *this; }
+};
+
+// Перемещение может бросить исключение, поэтому при росте вектор копирует
+struct ThrowingMove {
+  static inline int copies = 0;
+  int value = 0;
+
+  ThrowingMove(int value_ = 0):value(value_){}
+  ThrowingMove(const ThrowingMove &other):value(other.value){ ++copies; }
+  ThrowingMove(ThrowingMove &&other):value(other.value){}
+};
+
+void test_growth_moves_elements(){
+  Vector<MoveCounter> vector(0);
+  MoveCounter::copies = 0;
+  for(int i = 0; i < 1000; ++i){
+    vector.emplace_back(i);
+  }
+  assert(MoveCounter::copies == 0);
+  assert(vector.size() == 1000 && vector[999].value == 999);
+
+  MoveCounter item(5);
+  vector.push_back(std::move(item));
+  vector.push_back(item);
+  assert(MoveCounter::copies == 1);
+
+  Vector<ThrowingMove> throwing(0);
+  for(int i = 0; i < 100; ++i){
+    throwing.emplace_back(i);
+  }
+  assert(ThrowingMove::copies > 0);
+  assert(throwing[50].value == 50);
+}
+
+void test_move_constructor_and_assignment(){
+  Vector<std::string> vector(0);
+  vector.push_back(std::string(100, 'a'));
+  vector.emplace_back(3, 'b');
+  const char *data = &vector[0][0];
+
+  Vector<std::string> moved(std::move(vector));
+  assert(moved.size() == 2 && vector.size() == 0);
+  assert(&moved[0][0] == data && moved[1] == "bbb");
+
+  Vector<std::string> assigned;
+  assigned = std::move(moved);
+  assert(assigned.size() == 2 && moved.size() == 0 && &assigned[0][0] == data);
+
+  Vector<std::string> copied(assigned);
+  assert(copied.size() == 2 && copied[0] == assigned[0] && &copied[0][0] != data);
+  copied = copied;
+  assert(copied[1] == "bbb");
+}
+
+void test_emplace_back_from_own_element(){
+  Vector<std::string> vector(0);
+  vector.push_back("first");
+  for(int i = 0; i < 100; ++i){
+    vector.emplace_back(vector[0]);
+  }
+  assert(vector.size() == 101 && vector[100] == "first");
+  assert(vector.pop_back() == "first" && vector.size() == 100);
+  assert(vector.erase(0) == "first" && vector.size() == 99);
+}
+
+// Считает живые объекты
+struct LiveCounter {
+  static inline int alive = 0;
+  int value;
+
+  LiveCounter(int value_ = 0):value(value_){ ++alive; }
+  LiveCounter(const LiveCounter &other):value(other.value){ ++alive; }
+  ~LiveCounter(){ --alive; }
+};
+
+void test_reserve_does_not_construct(){
+  LiveCounter::alive = 0;
+  Vector<LiveCounter> vector;
+  assert(vector.capacity() == 0);
+  vector.reserve(1000);
+  assert(vector.capacity() == 1000 && vector.size() == 0);
+  assert(LiveCounter::alive == 0);
+  for(int i = 0; i < 1000; ++i){
+    vector.emplace_back(i);
+  }
+  assert(vector.capacity() == 1000 && LiveCounter::alive == 1000);
+  vector.reserve(10);
+  assert(vector.capacity() == 1000);
+
+  Vector<LiveCounter> sized(5);
+  assert(sized.size() == 5 && sized.capacity() == 5);
+  assert(LiveCounter::alive == 1005);
+}
+
+void test_resize_and_shrink_to_fit(){
+  LiveCounter::alive = 0;
+  {
+    Vector<LiveCounter> vector;
+    vector.resize(10, LiveCounter(7));
+    assert(vector.size() == 10 && vector[9].value == 7);
+    assert(LiveCounter::alive == 10);
+    vector.resize(4);
+    assert(vector.size() == 4 && LiveCounter::alive == 4);
+    assert(vector.capacity() >= 10);
+    vector.resize(6);
+    assert(vector[5].value == 0 && vector[3].value == 7);
+    vector.shrink_to_fit();
+    assert(vector.capacity() == 6 && vector.size() == 6);
+    // value из этого же вектора переживает переезд
+    vector.resize(100, vector[0]);
+    assert(vector[99].value == 7 && LiveCounter::alive == 100);
+    vector.clear();
+    vector.shrink_to_fit();
+    assert(vector.capacity() == 0 && LiveCounter::alive == 0);
+  }
+  assert(LiveCounter::alive == 0);
+}
+
+void test_growth_policies(){
+  Vector<int, GrowOneAndHalf> slow;
+  std::size_t previous = 0;
+  for(int i = 0; i < 100; ++i){
+    slow.push_back(i);
+    if(slow.capacity() != previous){
+      assert(previous < 2 || slow.capacity() == previous * 3 / 2);
+      previous = slow.capacity();
+    }
+  }
+
+  // 100 байт -> класс 112 байт, 1000 -> 1024
+  using Rounded = GrowthFactor<2, 1, true>;
+  assert(Rounded::fit(25, sizeof(int)) == 28);
+  assert(Rounded::fit(250, sizeof(int)) == 256);
+  assert(Rounded::fit(3, 1) == 16);
+  Vector<char, Rounded> chars;
+  chars.reserve(100);
+  assert(chars.capacity() == 112);
+}
+
+// insert/erase сверяются с std::vector и для memmove-пути (int), и для
+// обычного (std::string)
+template <class T, class Make> void check_insert_erase(Make make){
+  Vector<T> vector;
+  std::vector<T> expected;
+  for(int i = 0; i < 200; ++i){
+    std::size_t pos = (i * 7) % (expected.size() + 1);
+    vector.insert(pos, make(i));
+    expected.insert(expected.begin() + pos, make(i));
+  }
+  for(int i = 0; i < 150; ++i){
+    std::size_t pos = (i * 13) % expected.size();
+    assert(vector.erase(pos) == expected[pos]);
+    expected.erase(expected.begin() + pos);
+  }
+  assert(vector.size() == expected.size());
+  for(std::size_t i = 0; i < expected.size(); ++i){
+    assert(vector[i] == expected[i]);
+  }
+  Vector<T> copied(vector);
+  assert(copied.size() == expected.size() && copied[10] == expected[10]);
+}
+
+void test_insert_erase(){
+  check_insert_erase<int>([](int i){ return i; });
+  check_insert_erase<std::string>([](int i){ return std::string(20, 'a' + i % 26); });
+}
+
+template <class T, class Growth, std::size_t N>
+bool same(const Vector<T, Growth, N> &vector, const std::vector<T> &expected){
+  if(vector.size() != expected.size()){
+    return false;
+  }
+  for(std::size_t i = 0; i < expected.size(); ++i){
+    if(!(vector[i] == expected[i])){
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T, class Make> void check_range_operations(Make make){
+  std::vector<T> source;
+  for(int i = 0; i < 50; ++i){
+    source.push_back(make(i));
+  }
+  std::list<T> list(source.begin(), source.end());
+
+  Vector<T> vector(source.begin(), source.begin() + 10);
+  std::vector<T> expected(source.begin(), source.begin() + 10);
+  assert(same(vector, expected));
+
+  // с переездом в новый буфер и без него
+  vector.insert(3, list.begin(), list.end());
+  expected.insert(expected.begin() + 3, source.begin(), source.end());
+  assert(same(vector, expected));
+  vector.reserve(200);
+  vector.insert(0, source.begin() + 5, source.begin() + 25);
+  expected.insert(expected.begin(), source.begin() + 5, source.begin() + 25);
+  assert(same(vector, expected) && vector.capacity() == 200);
+  vector.append(source.data(), source.data() + 3);
+  expected.insert(expected.end(), source.begin(), source.begin() + 3);
+  assert(same(vector, expected));
+  vector.insert(7, source.begin(), source.begin());
+  assert(same(vector, expected));
+
+  // источник - часть самого вектора: до pos, через pos и в конце
+  int aliased[][3] = {{0, 2, 5}, {4, 2, 8}, {1, 80, 86}};
+  for(auto &range : aliased){
+    std::vector<T> part(expected.begin() + range[1], expected.begin() + range[2]);
+    vector.insert(range[0], vector.begin() + range[1], vector.begin() + range[2]);
+    expected.insert(expected.begin() + range[0], part.begin(), part.end());
+    assert(same(vector, expected));
+  }
+  assert(vector.capacity() == 200);
+
+  vector.erase(2, 40);
+  expected.erase(expected.begin() + 2, expected.begin() + 40);
+  assert(same(vector, expected));
+  vector.erase(5, 5);
+  assert(same(vector, expected));
+
+  vector.assign(list.begin(), list.end());
+  assert(same(vector, source));
+}
+
+void test_range_operations(){
+  check_range_operations<int>([](int i){ return i; });
+  check_range_operations<std::string>([](int i){ return std::string(20, 'a' + i % 26); });
+
+  // однопроходный итератор
+  std::istringstream in("4 5 6");
+  Vector<int> vector;
+  vector.push_back(1);
+  vector.push_back(2);
+  vector.insert(1, std::istream_iterator<int>(in), std::istream_iterator<int>());
+  assert(same(vector, {1, 4, 5, 6, 2}));
+
+  double numbers[] = {1.5, 2.5};
+  Vector<double> from_array(numbers, 2);
+  assert(from_array.size() == 2 && from_array[1] == 2.5);
+}
+
+// Элемент лежит внутри самого объекта вектора, а не в куче
+template <class V> bool stored_inline(V &vector){
+  const char *begin = reinterpret_cast<const char*>(&vector);
+  const char *element = reinterpret_cast<const char*>(&vector[0]);
+  return element >= begin && element < begin + sizeof(vector);
+}
+
+void test_small_vector(){
+  SmallVector<int, 4> small;
+  assert(small.capacity() == 4 && small.size() == 0);
+  for(int i = 0; i < 4; ++i){
+    small.push_back(i);
+  }
+  assert(small.capacity() == 4 && stored_inline(small));
+  small.insert(0, 42);
+  assert(small.capacity() == 8 && !stored_inline(small));
+  assert(same(small, {42, 0, 1, 2, 3}));
+  small.erase(0);
+  small.pop_back();
+  small.shrink_to_fit();
+  assert(small.capacity() == 4 && stored_inline(small) && same(small, {0, 1, 2}));
+  std::ostringstream out;
+  out << small;
+  assert(out.str() == "0 1 2 ");
+
+  // встроенные элементы перемещаются по одному, буфер из кучи забирается
+  SmallVector<std::string, 2> strings;
+  strings.push_back(std::string(100, 'a'));
+  const char *data = &strings[0][0];
+  SmallVector<std::string, 2> moved(std::move(strings));
+  assert(moved.size() == 1 && strings.size() == 0);
+  assert(stored_inline(moved) && &moved[0][0] == data);
+  moved.push_back("b");
+  moved.push_back("c");
+  const std::string *heap = &moved[0];
+  SmallVector<std::string, 2> stolen(std::move(moved));
+  assert(&stolen[0] == heap && moved.size() == 0 && moved.capacity() == 2);
+
+  moved.push_back("x");
+  stolen.swap(moved);
+  assert(stolen.size() == 1 && stolen[0] == "x" && stored_inline(stolen));
+  assert(moved.size() == 3 && &moved[0] == heap);
+  SmallVector<std::string, 2> copied(moved);
+  assert(same(copied, {std::string(100, 'a'), "b", "c"}));
+  copied = stolen;
+  assert(same(copied, {"x"}));
+  copied = std::move(moved);
+  assert(copied.size() == 3 && &copied[0] == heap && moved.capacity() == 2);
+
+  LiveCounter::alive = 0;
+  {
+    SmallVector<LiveCounter, 3> counters;
+    for(int i = 0; i < 10; ++i){
+      counters.emplace_back(i);
+    }
+    counters.erase(0, 8);
+    counters.shrink_to_fit();
+    assert(counters.capacity() == 3 && counters[1].value == 9);
+    assert(LiveCounter::alive == 2);
+    SmallVector<LiveCounter, 3> other(std::move(counters));
+    assert(other.size() == 2 && LiveCounter::alive == 2);
+    other.resize(3);
+    counters = other;
+    assert(LiveCounter::alive == 6);
+  }
+  assert(LiveCounter::alive == 0);
+}
+
+void test_iterators(){
+  Vector<int> vector;
+  for(int i = 0; i < 10; ++i){
+    vector.push_back((i * 7) % 10);
+  }
+  std::sort(vector.begin(), vector.end());
+  int expected = 0;
+  for(int x : vector){
+    assert(x == expected++);
+  }
+  assert(std::vector<int>(vector.rbegin(), vector.rend()).front() == 9);
+
+  const Vector<int> &view = vector;
+  assert(view.size() == 10 && !view.empty() && view.capacity() >= 10);
+  assert(&view[3] == view.data() + 3 && view.end() - view.begin() == 10);
+  assert(std::accumulate(view.cbegin(), view.cend(), 0) == 45);
+
+  // буфер можно писать и читать memcpy без промежуточной копии
+  int raw[10];
+  std::memcpy(raw, view.data(), sizeof(raw));
+  Vector<int> restored(10);
+  std::memcpy(restored.data(), raw, sizeof(raw));
+  assert(std::equal(restored.begin(), restored.end(), view.begin(), view.end()));
+
+  Vector<std::string> strings;
+  strings.push_back("b");
+  strings.push_back("a");
+  std::vector<std::string> copied(strings.size());
+  std::copy(strings.begin(), strings.end(), copied.begin());
+  assert(copied[0] == "b" && copied[1] == "a");
+  std::ostringstream out;
+  out << static_cast<const Vector<std::string>&>(strings);
+  assert(out.str() == "b a ");
+
+  Vector<int> empty;
+  assert(empty.begin() == empty.end() && empty.rbegin() == empty.rend());
+  SmallVector<int, 4> small(vector.begin(), vector.begin() + 3);
+  assert(small.end() - small.begin() == 3 && small.data()[2] == 2);
+
+#if __cplusplus >= 202002L
+  static_assert(std::contiguous_iterator<Vector<int>::iterator>);
+  static_assert(std::ranges::contiguous_range<Vector<int>>);
+  std::span<int> span = vector.span();
+  assert(span.size() == 10 && span.data() == vector.data());
+  std::span<const int> from_range(view);
+  assert(from_range.size() == 10 && view.span()[9] == 9);
+  std::ranges::sort(vector, std::greater<>{});
+  assert(span[0] == 9);
+#endif
+}
+
+struct Record {
+  std::uint64_t id;
+  double values[7];
+};
+
+void test_mapped_vector(){
+  std::string path = (std::filesystem::temp_directory_path() /
+                      ("mapped_vector_test_" + std::to_string(::getpid()) + ".bin")).string();
+  std::filesystem::remove(path);
+  {
+    MappedVector<Record> records(path);
+    assert(records.empty() && records.capacity() == 0);
+    for(std::uint64_t i = 0; i < 10000; ++i){
+      records.push_back(Record{i, {double(i)}});
+    }
+    records.emplace_back(records[0]);
+    records.insert(1, Record{42, {}});
+    assert(records.erase(0).id == 0 && records[0].id == 42);
+    records.erase(1, 3);
+    assert(records.pop_back().id == 0 && records.size() == 9998);
+    assert(records[1].id == 3 && records[9997].values[0] == 9999);
+    records.advise(MappedVector<Record>::Access::Sequential);
+    records.sync();
+  }
+  {
+    // после переоткрытия данные на месте; файл можно дописывать
+    MappedVector<Record> records(path);
+    assert(records.size() == 9998 && records[1].id == 3 && records.capacity() >= 9998);
+    std::vector<Record> more(5, Record{7, {}});
+    records.append(more.begin(), more.end());
+    records.resize(10010);
+    assert(records.size() == 10010 && records[10002].id == 7 && records[10003].id == 0 && records[10009].id == 0);
+    records.shrink_to_fit();
+    assert(records.capacity() == 10010);
+    assert(std::filesystem::file_size(path) ==
+           MappedVector<Record>::kHeaderBytes + 10010 * sizeof(Record));
+  }
+  {
+    // читатели только отображают файл, изменять его они не могут
+    MappedVector<Record> reader(path, MappedVector<Record>::Mode::ReadOnly);
+    MappedVector<Record> other(path, MappedVector<Record>::Mode::ReadOnly);
+    assert(reader.size() == 10010 && other[10002].id == 7);
+    reader.advise(MappedVector<Record>::Access::Random);
+    std::uint64_t sum = 0;
+    for(const Record &record : reader){
+      sum += record.id;
+    }
+    assert(sum == 9999ull * 10000 / 2 - 1 - 2 + 42 + 35);
+    bool thrown = false;
+    try{
+      reader.push_back(Record{});
+    }
+    catch(const std::logic_error &){
+      thrown = true;
+    }
+    assert(thrown && reader.size() == 10010);
+
+    MappedVector<Record> moved(std::move(reader));
+    assert(moved.size() == 10010 && reader.size() == 0);
+  }
+  {
+    // файл с записями другого размера не открывается
+    bool thrown = false;
+    try{
+      MappedVector<int> wrong(path);
+    }
+    catch(const std::runtime_error &){
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  std::filesystem::remove(path);
+
+  bool thrown = false;
+  try{
+    MappedVector<Record> missing(path, MappedVector<Record>::Mode::ReadOnly);
+  }
+  catch(const std::system_error &){
+    thrown = true;
+  }
+  assert(thrown);
+
+  MappedVector<int> numbers(path);
+  numbers.push_back(1);
+  numbers.push_back(2);
+  std::ostringstream out;
+  out << numbers;
+  assert(out.str() == "1 2 ");
+  std::filesystem::remove(path);
+}
+
+// Алгоритмы сверяются с std на маленьком векторе (один кусок, хвост мимо
+// SIMD) и на большом в 4 потоках
+template <class T, class Make> void check_algorithms(std::size_t n, Make make){
+  std::vector<T> expected;
+  for(std::size_t i = 0; i < n; ++i){
+    expected.push_back(make(i * 7919 % n));
+  }
+  Vector<T> vector(expected.begin(), expected.end());
+  const unsigned threads = 4;
+
+  T total{};
+  for(const T &x : expected){
+    total += x;
+  }
+  assert(vector.reduce(T{}, std::plus<>{}, threads) == total);
+  assert(vector.min(threads) == *std::min_element(expected.begin(), expected.end()));
+  assert(vector.max(threads) == *std::max_element(expected.begin(), expected.end()));
+  T needle = expected[n * 3 / 4];
+  std::size_t first = std::find(expected.begin(), expected.end(), needle) - expected.begin();
+  assert(vector.find(needle, threads) == first);
+  T largest = *std::max_element(expected.begin(), expected.end());
+  assert(vector.find(largest + largest, threads) == n);
+  assert(vector.count(needle, threads) == std::size_t(std::count(expected.begin(), expected.end(), needle)));
+
+  vector.transform([](const T &x){ return x + x; }, threads);
+  for(T &x : expected){
+    x = x + x;
+  }
+  assert(same(vector, expected));
+
+  T middle = make(n / 2) + make(n / 2);
+  std::size_t smaller = vector.partition([&](const T &x){ return x < middle; }, threads);
+  assert(smaller == std::size_t(std::count_if(expected.begin(), expected.end(), [&](const T &x){ return x < middle; })));
+  for(std::size_t i = 0; i < n; ++i){
+    assert((vector[i] < middle) == (i < smaller));
+  }
+
+  vector.sort(std::greater<>{}, threads);
+  std::sort(expected.begin(), expected.end(), std::greater<>{});
+  assert(same(vector, expected));
+}
+
+void test_algorithms(){
+  for(std::size_t n : {std::size_t(13), 3 * kParallelGrain + 5}){
+    // значения небольшие, чтобы сумма float считалась точно
+    check_algorithms<int>(n, [](std::size_t i){ return int(i % 1000) - 500; });
+    check_algorithms<float>(n, [](std::size_t i){ return float(i % 100); });
+    check_algorithms<double>(n, [](std::size_t i){ return double(i % 1000) / 4; });
+  }
+  check_algorithms<long long>(1000, [](std::size_t i){ return (long long)i << 33; });
+  check_algorithms<std::string>(2 * kParallelGrain, [](std::size_t i){ return std::to_string(i); });
+
+  Vector<int> empty;
+  assert(empty.reduce(7) == 7 && empty.find(1) == 0 && empty.count(1) == 0);
+  empty.sort();
+  assert(empty.partition([](int){ return true; }) == 0);
+  Vector<int> numbers;
+  for(int i = 1; i <= 5; ++i){
+    numbers.push_back(i);
+  }
+  assert(numbers.reduce(1, std::multiplies<>{}) == 120);
+
+  // сумма в long long не переполняется и в нескольких потоках
+  Vector<int> large;
+  for(std::size_t i = 0; i < 2 * kParallelGrain; ++i){
+    large.push_back(2000000000);
+  }
+  long long expected = 2000000000LL * large.size() + 1;
+  assert(large.reduce<long long>(1, std::plus<>{}, 4) == expected);
+  assert(large.reduce<long long>() == expected - 1);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Миллисекунды между двумя отметками Clock
+double ms(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// n коротких векторов по 6 элементов: Vector выделяет память при росте,
+// Vector с reserve - один раз, SmallVector<int, 8> - ни разу
+void bench_small_vectors(int n){
+  long long sum = 0;
+  auto start = Clock::now();
+  for(int i = 0; i < n; ++i){
+    Vector<int> vector;
+    for(int j = 0; j < 6; ++j){
+      vector.push_back(i + j);
+    }
+    sum += vector[5];
+  }
+  auto growing_done = Clock::now();
+  for(int i = 0; i < n; ++i){
+    Vector<int> vector;
+    vector.reserve(6);
+    for(int j = 0; j < 6; ++j){
+      vector.push_back(i + j);
+    }
+    sum += vector[5];
+  }
+  auto reserved_done = Clock::now();
+  for(int i = 0; i < n; ++i){
+    SmallVector<int, 8> vector;
+    for(int j = 0; j < 6; ++j){
+      vector.push_back(i + j);
+    }
+    sum += vector[5];
+  }
+  auto small_done = Clock::now();
+  std::cout << n << " short-lived vectors of 6 ints: Vector " << ms(start, growing_done)
+            << " ms, Vector + reserve " << ms(growing_done, reserved_done)
+            << " ms, SmallVector<int, 8> " << ms(reserved_done, small_done)
+            << " ms (checksum " << sum << ")" << std::endl;
+}
+
+// Выгрузка n int в std::vector: поэлементно через operator[] против
+// конструктора из диапазона указателей (одно копирование памяти)
+void bench_export(int n){
+  Vector<int> vector(n);
+  auto start = Clock::now();
+  std::vector<int> by_index;
+  for(std::size_t i = 0; i < vector.size(); ++i){
+    by_index.push_back(vector[i]);
+  }
+  auto index_done = Clock::now();
+  std::vector<int> by_range(vector.begin(), vector.end());
+  auto range_done = Clock::now();
+  assert(by_index == by_range);
+  std::cout << "export " << n << " ints to std::vector: push_back by index " << ms(start, index_done)
+            << " ms, from [begin, end) " << ms(index_done, range_done) << " ms" << std::endl;
+}
+
+// "Перезапуск" с n записями по 64 байта: чтение файла в Vector через fread
+// против открытия MappedVector, и полный проход по тем и другим
+void bench_mapped_reload(int n){
+  if(n <= 0){
+    return;
+  }
+  auto dir = std::filesystem::temp_directory_path();
+  std::string raw_path = (dir / ("vector_bench_" + std::to_string(::getpid()) + ".raw")).string();
+  std::string mapped_path = (dir / ("vector_bench_" + std::to_string(::getpid()) + ".mapped")).string();
+  {
+    Vector<Record> records;
+    MappedVector<Record> mapped(mapped_path);
+    for(int i = 0; i < n; ++i){
+      records.push_back(Record{std::uint64_t(i), {}});
+      mapped.push_back(Record{std::uint64_t(i), {}});
+    }
+    std::FILE *file = std::fopen(raw_path.c_str(), "wb");
+    std::fwrite(records.data(), sizeof(Record), records.size(), file);
+    std::fclose(file);
+  }
+
+  auto start = Clock::now();
+  Vector<Record> loaded(n);
+  std::FILE *file = std::fopen(raw_path.c_str(), "rb");
+  std::size_t read = std::fread(loaded.data(), sizeof(Record), n, file);
+  std::fclose(file);
+  auto loaded_done = Clock::now();
+  MappedVector<Record> mapped(mapped_path, MappedVector<Record>::Mode::ReadOnly);
+  std::uint64_t probe = mapped[n / 2].id;
+  auto opened_done = Clock::now();
+  std::uint64_t sum = 0;
+  for(const Record &record : loaded){
+    sum += record.id;
+  }
+  auto loaded_scan = Clock::now();
+  mapped.advise(MappedVector<Record>::Access::Sequential);
+  for(const Record &record : mapped){
+    sum -= record.id;
+  }
+  auto mapped_scan = Clock::now();
+  assert(read == std::size_t(n) && sum == 0 && probe == std::uint64_t(n / 2));
+  std::filesystem::remove(raw_path);
+  std::filesystem::remove(mapped_path);
+  std::cout << "restart with " << n << " x 64-byte records: fread into Vector " << ms(start, loaded_done)
+            << " ms, open MappedVector + one read " << ms(loaded_done, opened_done)
+            << " ms; full scan Vector " << ms(opened_done, loaded_scan) << " ms, MappedVector "
+            << ms(loaded_scan, mapped_scan) << " ms" << std::endl;
+}
+
+// Циклы по индексу против SIMD-ядер в одном потоке на n int
+void bench_algorithms(int n){
+  if(n <= 0){
+    return;
+  }
+  Vector<int> vector;
+  for(int i = 0; i < n; ++i){
+    vector.push_back(int(i * 7919LL % 1000));
+  }
+  auto start = Clock::now();
+  long long sum = 0;
+  std::size_t equal = 0, found = vector.size();
+  int smallest = vector[0];
+  for(std::size_t i = 0; i < vector.size(); ++i){
+    sum += vector[i];
+  }
+  for(std::size_t i = 0; i < vector.size(); ++i){
+    equal += vector[i] == 500;
+  }
+  for(std::size_t i = 0; i < vector.size(); ++i){
+    if(vector[i] == -1){
+      found = i;
+      break;
+    }
+  }
+  for(std::size_t i = 0; i < vector.size(); ++i){
+    smallest = std::min(smallest, vector[i]);
+  }
+  auto loops_done = Clock::now();
+  long long simd_sum = vector.reduce<long long>(0, std::plus<>{}, 1);
+  std::size_t simd_equal = vector.count(500, 1);
+  std::size_t simd_found = vector.find(-1, 1);
+  int simd_smallest = vector.min(1);
+  auto kernels_done = Clock::now();
+  assert(simd_sum == sum && simd_equal == equal && simd_found == found && simd_smallest == smallest);
+  std::cout << "sum+count+find+min over " << n << " ints: index loops "
+            << ms(start, loops_done) << " ms, Vector algorithms (" << Simd<int>::kEnabled * 32 * Simd<int>::kWidth
+            << "-bit SIMD, 1 thread) " << ms(loops_done, kernels_done) << " ms" << std::endl;
+}
+
+// Время алгоритмов на n int в 1, 2, 4... потоках. Запуск: ./main scaling [n]
+void bench_scaling(std::size_t n){
+  Vector<int> source;
+  source.reserve(n);
+  for(std::size_t i = 0; i < n; ++i){
+    source.push_back(int(i * 2654435761u % 16));
+  }
+  unsigned cores = std::thread::hardware_concurrency();
+  std::cout << n << " ints, " << cores << " hardware threads" << std::endl;
+  for(unsigned threads = 1; threads <= std::max(2u, cores); threads *= 2){
+    Vector<int> vector(source);
+    auto start = Clock::now();
+    long long sum = vector.reduce(0, std::plus<>{}, threads);
+    auto reduced = Clock::now();
+    std::size_t equal = vector.count(7, threads);
+    auto counted = Clock::now();
+    int smallest = vector.min(threads);
+    auto minimized = Clock::now();
+    vector.transform([](int x){ return x * 3 + 1; }, threads);
+    auto transformed = Clock::now();
+    vector.sort(std::less<>{}, threads);
+    auto sorted = Clock::now();
+    std::cout << "  " << threads << " threads: reduce " << ms(start, reduced)
+              << " ms, count " << ms(reduced, counted) << " ms, min " << ms(counted, minimized)
+              << " ms, transform " << ms(minimized, transformed) << " ms, sort "
+              << ms(transformed, sorted) << " ms (" << sum + equal + smallest << ")" << std::endl;
+  }
+}
+
+// Рост вектора из n строк и из n маленьких векторов. Запуск: ./main bench [n]
+void bench_push_back(int n){
+  auto start = Clock::now();
+  Vector<std::string> strings(0);
+  for(int i = 0; i < n; ++i){
+    strings.push_back(std::string(32, 'a' + i % 26));
+  }
+  auto strings_done = Clock::now();
+  Vector<std::vector<int>> vectors(0);
+  for(int i = 0; i < n; ++i){
+    vectors.push_back(std::vector<int>(16, i));
+  }
+  auto vectors_done = Clock::now();
+  std::cout << "push_back " << n << " strings: " << ms(start, strings_done)
+            << " ms, " << n << " vector<int>(16): " << ms(strings_done, vectors_done)
+            << " ms" << std::endl;
+}
+
+// Подготовка буфера на n элементов: резерв без создания элементов против
+// вектора из n T{}, и сколько раз переезжает вектор при росте 2x и 1.5x
+void bench_reserve(int n){
+  struct Record { char payload[64]; };
+  auto start = Clock::now();
+  Vector<Record> reserved;
+  reserved.reserve(n);
+  auto reserve_done = Clock::now();
+  Vector<Record> sized(n);
+  auto sized_done = Clock::now();
+
+  auto count_moves = [n](auto vector) {
+    int reallocations = 0;
+    std::size_t capacity = vector.capacity();
+    for(int i = 0; i < n; ++i){
+      vector.push_back(i);
+      if(vector.capacity() != capacity){
+        ++reallocations;
+        capacity = vector.capacity();
+      }
+    }
+    return std::pair{reallocations, capacity};
+  };
+  auto [twice, twice_capacity] = count_moves(Vector<int, GrowTwice>());
+  auto [half, half_capacity] = count_moves(Vector<int, GrowOneAndHalf>());
+  std::cout << "buffer of " << n << " x 64 bytes: reserve " << ms(start, reserve_done)
+            << " ms, Vector(n) " << ms(reserve_done, sized_done) << " ms; push_back "
+            << n << ": 2x - " << twice << " reallocations, capacity " << twice_capacity
+            << "; 1.5x - " << half << " reallocations, capacity " << half_capacity
+            << std::endl;
+}
+
+// k вставок и k удалений в середине вектора из n элементов
+template <class T> void bench_middle_insert_erase(int n, int k, const char *name){
+  Vector<T> vector(0);
+  for(int i = 0; i < n; ++i){
+    vector.push_back(T{});
+  }
+  auto start = Clock::now();
+  for(int i = 0; i < k; ++i){
+    vector.insert(vector.size() / 2, T{});
+  }
+  auto inserted = Clock::now();
+  for(int i = 0; i < k; ++i){
+    vector.erase(vector.size() / 2);
+  }
+  auto erased = Clock::now();
+  assert(vector.size() == static_cast<std::size_t>(n));
+  std::cout << name << ": " << k << " middle inserts into " << n << " elements "
+            << ms(start, inserted) << " ms, " << k << " middle erases "
+            << ms(inserted, erased) << " ms" << std::endl;
+}
+
+struct Point3 { double x, y, z; };
+
+// Слияние пачек: batches пачек по batch элементов вставляются в начало
+// вектора - по одному элементу и целым диапазоном
+void bench_merge_batches(int batches, int batch){
+  std::vector<int> incoming(batch);
+  for(int i = 0; i < batch; ++i){
+    incoming[i] = i;
+  }
+  auto start = Clock::now();
+  Vector<int> one_by_one;
+  for(int b = 0; b < batches; ++b){
+    for(int i = 0; i < batch; ++i){
+      one_by_one.insert(i, incoming[i]);
+    }
+  }
+  auto single_done = Clock::now();
+  Vector<int> ranged;
+  for(int b = 0; b < batches; ++b){
+    ranged.insert(0, incoming.begin(), incoming.end());
+  }
+  auto range_done = Clock::now();
+  assert(one_by_one.size() == ranged.size());
+
+  std::cout << "merge " << batches << " batches of " << batch << " ints at the front: insert one by one "
+            << ms(start, single_done) << " ms, insert range " << ms(single_done, range_done)
+            << " ms" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    int n = argc > 2 ? std::stoi(argv[2]) : 1000000;
+    bench_reserve(n);
+    bench_push_back(n);
+    bench_middle_insert_erase<int>(n, 1000, "int");
+    bench_middle_insert_erase<Point3>(n, 1000, "Point3");
+    bench_merge_batches(100, n / 1000);
+    bench_small_vectors(n);
+    bench_algorithms(n);
+    bench_export(n);
+    bench_mapped_reload(n);
+    return 0;
+  }
+  if (argc > 1 && std::string(argv[1]) == "scaling") {
+    bench_scaling(argc > 2 ? std::stoull(argv[2]) : 100000000);
+    return 0;
+  }
+
+  test_growth_moves_elements();
+  test_move_constructor_and_assignment();
+  test_emplace_back_from_own_element();
+  test_reserve_does_not_construct();
+  test_resize_and_shrink_to_fit();
+  test_growth_policies();
+  test_insert_erase();
+  test_range_operations();
+  test_small_vector();
+  test_iterators();
+  test_mapped_vector();
+  test_algorithms();
+
   Vector<int> vector;
 
   vector.push_back(1);